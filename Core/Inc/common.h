@@ -30,16 +30,25 @@ typedef unsigned int size_t;
 #define TID_NULL 0
 
 // System limits
-#define MAX_TASKS 16
+#ifndef MAX_TASKS
+#define MAX_TASKS 256   // TIDs, TCBs themselves are pool allocated on create
+#endif
 #define STACK_SIZE 0x400   // 1kb minimum stack size per task
 
+// Stack painting
+#define STACK_PAINT 0xC5C5C5C5   // pattern written over a fresh task stack
+#define STACK_GUARD_WORDS 4      // painted words at the bottom checked on every context switch
+
 // Type aliases for clarity
 typedef uint32_t U32;
 typedef uint16_t U16;
 typedef uint8_t  U8;
+typedef uint64_t U64;
 typedef U32 task_t;
 
 // Task Control Block (TCB)
+// Public copy handed to osCreateTask/osTaskInfo, layout kept stable for callers.
+// The kernel keeps its own aligned k_tcb_t and hot state arrays (k_task.h).
 typedef struct task_control_block {
     void (*ptask)(void* args);   // Pointer to task entry function - offset 0
     U32 stack_high;              // Start address (high) of task stack - offset 4
@@ -56,6 +65,8 @@ typedef struct task_control_block {
     U32 next_period_start;       // When the next period should start - offset 40/44
     U8 is_periodic;              // 0 for regular tasks, 1 for periodic tasks - offset 44/48
     void* stack_base;            // Base pointer returned by k_mem_alloc for freeing
+    U32 stack_hwm;               // Peak stack usage in bytes, filled in by osTaskInfo
+    void* args;                  // Passed to ptask in R0
 } __attribute__((packed)) TCB;
 
 // Return codes for kernel functions
@@ -0,0 +1,51 @@
+/*
+ * k_cbs.h
+ *
+ *  Constant bandwidth servers for aperiodic and soft real time work. A
+ *  server task gets a (budget, period) reservation: it is scheduled by EDF
+ *  like a task with the server's deadline, and every budget ms of CPU it
+ *  uses pushes that deadline back by a period. A server can therefore never
+ *  take more than budget/period of the CPU away from the hard tasks, however
+ *  much work is queued on it.
+ *
+ *  void Console(void* args) {
+ *      while (1) {
+ *          osServerWait();           // one call per osServerSignal
+ *          handle_command();
+ *      }
+ *  }
+ */
+
+#ifndef INC_K_CBS_H_
+#define INC_K_CBS_H_
+
+#include "common.h"
+
+typedef struct k_cbs {
+    U32 budget;             // Q, ms of CPU per period
+    U32 period;             // T, relative server deadline
+    U32 remaining;          // budget left before the deadline is postponed
+    U32 deadline;           // absolute server deadline in ticks
+    U32 postponed;          // times the budget ran out
+    U16 pending;            // signalled jobs not yet taken by osServerWait
+    U8 waiting;             // server task blocked in osServerWait
+    task_t tid;
+} k_cbs_t;
+
+// creates task as a server with the given reservation, server must outlive the task
+int osCreateServerTask(k_cbs_t* server, U32 budget, U32 period, TCB* task);
+
+// blocks the calling server task until a job has been signalled
+void osServerWait(void);
+
+// queues one job on the server task tid and wakes it if it was waiting
+int osServerSignal(task_t tid);
+
+// same from an ISR, see osEndISR in k_task.h
+int osServerSignalFromISR(task_t tid, int* switch_needed);
+
+// kernel side
+void k_cbs_attach(k_cbs_t* server, task_t tid);
+int k_cbs_tick(k_cbs_t* server);
+
+#endif /* INC_K_CBS_H_ */
@@ -0,0 +1,47 @@
+/*
+ * k_crit.h
+ *
+ *  Kernel critical sections. Instead of cpsid i they raise BASEPRI to
+ *  KERNEL_IRQ_CEILING, so interrupts with a numerically lower priority
+ *  (0 .. ceiling-1) are never held off by the kernel. Those interrupts must
+ *  not call into the kernel. SysTick and SVC run at the ceiling, PendSV at
+ *  the lowest priority; any other ISR that uses the kernel needs a priority
+ *  between the ceiling and KERNEL_PRIO_LOWEST.
+ */
+
+#ifndef INC_K_CRIT_H_
+#define INC_K_CRIT_H_
+
+#include "common.h"
+
+// priority bits implemented by the STM32F4 NVIC
+#define KERNEL_PRIO_BITS 4
+#define KERNEL_PRIO_LOWEST ((1 << KERNEL_PRIO_BITS) - 1)
+
+// most urgent priority allowed to touch kernel state
+#ifndef KERNEL_IRQ_CEILING
+#define KERNEL_IRQ_CEILING 5
+#endif
+
+#if KERNEL_IRQ_CEILING < 1 || KERNEL_IRQ_CEILING > KERNEL_PRIO_LOWEST - 1
+#error "KERNEL_IRQ_CEILING must leave room above it and PendSV below it"
+#endif
+
+#define KERNEL_BASEPRI (KERNEL_IRQ_CEILING << (8 - KERNEL_PRIO_BITS))
+
+// enter a critical section, returns the BASEPRI to hand back to k_crit_exit
+static inline U32 k_crit_enter(void) {
+    U32 prev;
+    __asm volatile ("MRS %0, basepri" : "=r" (prev));
+    // basepri_max only ever raises the mask, so nesting inside an ISR is safe
+    __asm volatile ("MSR basepri_max, %0\n\tisb" : : "r" (KERNEL_BASEPRI) : "memory");
+    return prev;
+}
+
+static inline void k_crit_exit(U32 prev) {
+    __asm volatile ("MSR basepri, %0" : : "r" (prev) : "memory");
+}
+
+// no SVC may be issued inside a critical section, it would escalate to HardFault
+
+#endif /* INC_K_CRIT_H_ */
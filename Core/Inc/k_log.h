@@ -0,0 +1,60 @@
+/*
+ * k_log.h
+ *
+ *  Deferred binary logging. LOG() only stores the address of its format
+ *  string plus the raw 32 bit arguments in a lock-free ring buffer; the
+ *  strings themselves live in the non-loaded .log_fmt section of the ELF
+ *  and Tools/log_decode.py turns the raw stream back into text on the host.
+ *
+ *  Safe to call from tasks and interrupt handlers.
+ */
+
+#ifndef INC_K_LOG_H_
+#define INC_K_LOG_H_
+
+#include "common.h"
+
+// set to 0 to compile every LOG() call away
+#ifndef LOG_ENABLED
+#define LOG_ENABLED 1
+#endif
+
+// ring buffer size in 32 bit words (must be a power of 2)
+#ifndef LOG_BUF_WORDS
+#define LOG_BUF_WORDS 512
+#endif
+
+// max args per LOG() call
+#define LOG_MAX_ARGS 4
+
+// record layout: header, format id, timestamp, args
+#define LOG_MAGIC 0xA5
+#define LOG_HDR_WORDS 3
+#define LOG_ID_DROPPED 0xFFFFFFFF   // record reporting how many records were dropped
+
+// counts the args of a LOG() call (0 to 4)
+#define LOG_NARGS_(_0, _1, _2, _3, _4, N, ...) N
+#define LOG_NARGS(...) LOG_NARGS_(_0, ##__VA_ARGS__, 4, 3, 2, 1, 0)
+
+#if LOG_ENABLED
+// args must be 32 bit integers (cast pointers to U32), %s can't be decoded
+#define LOG(fmt, ...) \
+    do { \
+        static const char _log_fmt[] __attribute__((section(".log_fmt"), used)) = fmt; \
+        const U32 _log_args[LOG_MAX_ARGS + 1] = { 0, ##__VA_ARGS__ }; \
+        k_log_write((U32)_log_fmt, &_log_args[1], LOG_NARGS(__VA_ARGS__)); \
+    } while (0)
+#else
+#define LOG(fmt, ...) do { } while (0)
+#endif
+
+// stores one record, returns RTX_ERR and counts a drop if the buffer is full
+int k_log_write(U32 fmt_id, const U32* args, U32 nargs);
+
+// pushes committed records out of the UART, only call from one task at a time
+int k_log_flush(void);
+
+// number of records dropped since boot
+U32 k_log_dropped(void);
+
+#endif /* INC_K_LOG_H_ */
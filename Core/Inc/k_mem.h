@@ -12,7 +12,10 @@
 
 #include "common.h"
 
-
+// allocation hints, long lived blocks are carved from the top of the heap
+// and transient ones first fit from the bottom so they don't pin each other
+#define MEM_TRANSIENT 0
+#define MEM_LONG_LIVED 1
 
 
 // Initialize memory manager
@@ -22,6 +25,9 @@ int k_mem_init(void);
 // Allocate memory with First Fit algorithm
 void* k_mem_alloc(size_t size);
 
+// Allocate memory from the end of the heap picked by hint
+void* k_mem_alloc_hint(size_t size, U8 hint);
+
 
 
 // Deallocate memory
@@ -32,8 +38,13 @@ int k_mem_dealloc(void* ptr);
 int k_mem_count_extfrag(size_t size);
 
 
+// hands an allocated block to another task, TID_NULL makes it kernel owned
+int k_mem_set_owner(void* ptr, task_t tid);
+
+
 // impl functions for svc
 void* k_mem_alloc_impl(size_t size);
+void* k_mem_alloc_hint_impl(size_t size, U8 hint);
 int k_mem_init_impl(void);
 int k_mem_count_extfrag_impl(size_t size);
 int k_mem_dealloc_impl(void* ptr);
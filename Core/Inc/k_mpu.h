@@ -0,0 +1,43 @@
+/*
+ * k_mpu.h
+ *
+ *  Optional MPU stack guards. With MPU_STACK_GUARD set, the lowest
+ *  MPU_GUARD_SIZE bytes below every task stack are made no-access and the
+ *  guard region is moved to the incoming task on each context switch, so an
+ *  overflow faults straight away instead of scribbling on the heap.
+ *
+ *  The guard only catches an overflow that touches it. A function whose
+ *  frame is bigger than the guard can move sp past it and write below it
+ *  without faulting, so size the guard from the largest frame that
+ *  Tools/stack_analyze.py reports for the tasks.
+ */
+
+#ifndef INC_K_MPU_H_
+#define INC_K_MPU_H_
+
+#include "common.h"
+
+// set to 1 to enable MPU stack guards
+#ifndef MPU_STACK_GUARD
+#define MPU_STACK_GUARD 0
+#endif
+
+// guard size, must be a power of 2 and at least 32
+#ifndef MPU_GUARD_SIZE
+#define MPU_GUARD_SIZE 32
+#endif
+
+#if MPU_GUARD_SIZE < 32 || (MPU_GUARD_SIZE & (MPU_GUARD_SIZE - 1)) != 0
+#error "MPU_GUARD_SIZE must be a power of 2 and at least 32"
+#endif
+
+#define MPU_GUARD_REGION 0
+
+// cycles spent reprogramming the guard on the last switch and the worst seen
+extern volatile U32 g_mpu_switch_cycles;
+extern volatile U32 g_mpu_switch_cycles_max;
+
+void k_mpu_init(void);
+void k_mpu_set_stack_guard(U32 guard_base);
+
+#endif /* INC_K_MPU_H_ */
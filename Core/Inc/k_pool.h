@@ -0,0 +1,29 @@
+/*
+ * k_pool.h
+ *
+ *  Fixed size kernel object pool. Objects are carved out of k_mem chunks
+ *  on demand and recycled through a free list, so alloc and free are O(1)
+ *  and never fragment the general heap. Chunks are only given back when
+ *  the heap is reset by osKernelInit.
+ */
+
+#ifndef INC_K_POOL_H_
+#define INC_K_POOL_H_
+
+#include "common.h"
+
+typedef struct k_pool {
+    void* free_list;      // singly linked through the first word of each free object
+    U32 obj_size;         // rounded up to a multiple of 4
+    U32 per_chunk;        // objects carved from each k_mem allocation
+    U32 in_use;           // objects currently handed out
+    U32 capacity;         // objects carved so far
+} k_pool_t;
+
+void k_pool_init(k_pool_t* pool, U32 obj_size, U32 per_chunk);
+void* k_pool_alloc(k_pool_t* pool);
+
+// also safe from ISRs at or below KERNEL_IRQ_CEILING, it never schedules
+void k_pool_free(k_pool_t* pool, void* obj);
+
+#endif /* INC_K_POOL_H_ */
@@ -0,0 +1,36 @@
+/*
+ * k_prof.h
+ *
+ *  Statistical PC sampling profiler. Every tick the stacked PC of the
+ *  interrupted task is bucketed into a histogram over .text, along with a
+ *  per task sample count. k_prof_dump() prints the histogram and
+ *  Tools/prof_report.py maps it back to functions using the ELF.
+ */
+
+#ifndef INC_K_PROF_H_
+#define INC_K_PROF_H_
+
+#include "common.h"
+
+// set to 1 to sample from SysTick_Handler
+#ifndef PROF_ENABLED
+#define PROF_ENABLED 0
+#endif
+
+// number of histogram buckets, bucket width is picked at init to cover .text
+#ifndef PROF_BUCKETS
+#define PROF_BUCKETS 2048
+#endif
+
+void k_prof_init(void);
+void k_prof_start(void);
+void k_prof_stop(void);
+void k_prof_reset(void);
+
+// takes one sample, call from SysTick_Handler or a faster timer ISR
+void k_prof_tick(void);
+
+// prints the non-empty buckets and per task counts over printf
+void k_prof_dump(void);
+
+#endif /* INC_K_PROF_H_ */
@@ -0,0 +1,33 @@
+/*
+ * k_shared.h
+ *
+ *  Kernel data page. The current TID, the tick count and the per task
+ *  state array are kept together in .bss.kshared, and tasks read them with
+ *  plain loads instead of trapping into the kernel. Tasks run privileged,
+ *  so nothing stops them writing the page either; only use the readers.
+ */
+
+#ifndef INC_K_SHARED_H_
+#define INC_K_SHARED_H_
+
+#include "k_task.h"
+
+// put a kernel variable on the shared page
+#define KSHARED __attribute__((section(".bss.kshared")))
+
+// TID of the running task, same as osGetTID without the SVC
+static inline task_t osGetTIDFast(void) {
+    return *(volatile task_t*)&g_active_task_id;
+}
+
+// ms since osKernelStart
+static inline U32 osGetTime(void) {
+    return g_system_time;
+}
+
+// DORMANT, READY, RUNNING or SLEEPING as last written by the kernel
+static inline U8 osGetTaskState(task_t tid) {
+    return tid < MAX_TASKS ? ((volatile U8*)g_task_state)[tid] : DORMANT;
+}
+
+#endif /* INC_K_SHARED_H_ */
@@ -0,0 +1,48 @@
+/*
+ * k_slab.h
+ *
+ *  Stack slab. STACK_SLAB_COUNT stacks of STACK_SLAB_SIZE bytes are
+ *  reserved in .bss and handed out through a free bitmap, so creating and
+ *  exiting a short lived task never walks or fragments the k_mem heap.
+ *  Tasks whose stack does not fit, or that find the slab empty, still get
+ *  a heap stack.
+ */
+
+#ifndef INC_K_SLAB_H_
+#define INC_K_SLAB_H_
+
+#include "common.h"
+
+// number of slab stacks, 0 = no slab
+#ifndef STACK_SLAB_COUNT
+#define STACK_SLAB_COUNT 0
+#endif
+
+// usable bytes per slab stack, multiple of 8 (and of MPU_GUARD_SIZE with MPU_STACK_GUARD)
+#ifndef STACK_SLAB_SIZE
+#define STACK_SLAB_SIZE STACK_SIZE
+#endif
+
+#if STACK_SLAB_COUNT
+#if STACK_SLAB_SIZE < STACK_SIZE || STACK_SLAB_SIZE % 8 != 0
+#error "STACK_SLAB_SIZE must be at least STACK_SIZE and a multiple of 8"
+#endif
+
+// creates that fitted in the slab but found it full
+extern U32 g_stack_slab_misses;
+
+void k_stack_slab_init(void);
+
+// lowest free slot, the guard region (MPU_STACK_GUARD) comes first, NULL when full
+void* k_stack_slab_alloc(void);
+
+// 1 if stack is the base of a slab slot
+int k_stack_slab_owns(const void* stack);
+
+// RTX_ERR if stack did not come from the slab
+int k_stack_slab_free(void* stack);
+
+U32 k_stack_slab_in_use(void);
+#endif
+
+#endif /* INC_K_SLAB_H_ */
@@ -0,0 +1,96 @@
+/*
+ * k_syscall.h
+ *
+ *  System call numbers and the user side stubs. Every call traps with
+ *  svc #0; the number travels in r12 and up to four arguments in r0-r3,
+ *  the result comes back in r0. SVC_Handler_Main indexes syscall_table
+ *  with the stacked r12, so no call has to read its own instruction back.
+ */
+
+#ifndef INC_K_SYSCALL_H_
+#define INC_K_SYSCALL_H_
+
+#include "k_task.h"
+
+#define SYS_KERNEL_START 0
+#define SYS_YIELD 1
+#define SYS_CREATE_TASK 2
+#define SYS_CREATE_DEADLINE_TASK 3
+#define SYS_SET_DEADLINE 4
+#define SYS_TASK_INFO 5
+#define SYS_CREATE_SERVER_TASK 6
+#define SYS_MEM_INIT 7
+#define SYS_MEM_ALLOC 8
+#define SYS_MEM_DEALLOC 9
+#define SYS_MEM_EXTFRAG 10
+#define SYS_GET_TID 11
+#define SYS_TASK_EXIT 12
+#define SYS_KERNEL_INIT 13
+#define SYSCALL_COUNT 14
+
+typedef U32 (*syscall_fn)(U32 a0, U32 a1, U32 a2, U32 a3);
+
+// Round trip cycles of the last call per number, set SCHED_STATS to 1
+#if SCHED_STATS
+extern U32 g_syscall_cycles[SYSCALL_COUNT];
+#define SYSCALL_CYCCNT (*(volatile U32 *)0xE0001004UL)
+#define SYSCALL_STAT_BEGIN() U32 sys_start = SYSCALL_CYCCNT
+#define SYSCALL_STAT_END(nr) g_syscall_cycles[nr] = SYSCALL_CYCCNT - sys_start
+#else
+#define SYSCALL_STAT_BEGIN()
+#define SYSCALL_STAT_END(nr)
+#endif
+
+// r1-r3 and r12 come back from the exception frame untouched, only r0 changes
+static inline U32 k_syscall0(U32 nr) {
+    register U32 r0 __asm("r0");
+    register U32 r12 __asm("r12") = nr;
+    SYSCALL_STAT_BEGIN();
+    __asm volatile ("svc #0" : "=r" (r0) : "r" (r12) : "memory");
+    SYSCALL_STAT_END(nr);
+    return r0;
+}
+
+static inline U32 k_syscall1(U32 nr, U32 a0) {
+    register U32 r0 __asm("r0") = a0;
+    register U32 r12 __asm("r12") = nr;
+    SYSCALL_STAT_BEGIN();
+    __asm volatile ("svc #0" : "+r" (r0) : "r" (r12) : "memory");
+    SYSCALL_STAT_END(nr);
+    return r0;
+}
+
+static inline U32 k_syscall2(U32 nr, U32 a0, U32 a1) {
+    register U32 r0 __asm("r0") = a0;
+    register U32 r1 __asm("r1") = a1;
+    register U32 r12 __asm("r12") = nr;
+    SYSCALL_STAT_BEGIN();
+    __asm volatile ("svc #0" : "+r" (r0) : "r" (r1), "r" (r12) : "memory");
+    SYSCALL_STAT_END(nr);
+    return r0;
+}
+
+static inline U32 k_syscall3(U32 nr, U32 a0, U32 a1, U32 a2) {
+    register U32 r0 __asm("r0") = a0;
+    register U32 r1 __asm("r1") = a1;
+    register U32 r2 __asm("r2") = a2;
+    register U32 r12 __asm("r12") = nr;
+    SYSCALL_STAT_BEGIN();
+    __asm volatile ("svc #0" : "+r" (r0) : "r" (r1), "r" (r2), "r" (r12) : "memory");
+    SYSCALL_STAT_END(nr);
+    return r0;
+}
+
+static inline U32 k_syscall4(U32 nr, U32 a0, U32 a1, U32 a2, U32 a3) {
+    register U32 r0 __asm("r0") = a0;
+    register U32 r1 __asm("r1") = a1;
+    register U32 r2 __asm("r2") = a2;
+    register U32 r3 __asm("r3") = a3;
+    register U32 r12 __asm("r12") = nr;
+    SYSCALL_STAT_BEGIN();
+    __asm volatile ("svc #0" : "+r" (r0) : "r" (r1), "r" (r2), "r" (r3), "r" (r12) : "memory");
+    SYSCALL_STAT_END(nr);
+    return r0;
+}
+
+#endif /* INC_K_SYSCALL_H_ */
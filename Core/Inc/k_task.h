@@ -10,11 +10,148 @@
 #ifndef INC_K_TASK_H_
 #define INC_K_TASK_H_
 #include "common.h"
+#include "k_mpu.h"
 #define TASK_NEW 0
 #define TASK_EXISTING 1
 
-extern TCB g_tasks[MAX_TASKS];
-extern task_t g_current_tid;
+struct k_cbs;
+
+// release statistics kept by osWaitUntilNextPeriod
+typedef struct period_stats {
+    U32 releases;                // jobs released
+    U32 overruns;                // calls that found the release already passed
+    U32 jitter_last_us;          // how long after its release the last job started
+    U32 jitter_max_us;
+} period_stats_t;
+
+// Kernel side TCB, only the cold creation time fields, naturally aligned.
+// The public TCB in common.h is only built on demand by osTaskInfo.
+typedef struct k_tcb {
+    void (*ptask)(void* args);   // Task entry function
+    void* args;                  // Passed to ptask in R0
+    U32 stack_high;              // Start address (high) of task stack
+    void* stack_base;            // Base pointer returned by k_mem_alloc for freeing
+    struct k_cbs* server;        // bandwidth server reservation, NULL for ordinary tasks
+    U32 preempt_threshold;       // only deadlines below this preempt the task, 0 = any ready task
+    U32 sleep_time;              // Time remaining to sleep (0 if not sleeping)
+    U32 period;                  // Period for periodic tasks (0 if not periodic)
+    U32 next_period_start;       // Release time (g_system_time) of the current job
+    period_stats_t period_stats; // Release jitter, see osWaitUntilNextPeriod
+    task_t tid;                  // Task ID
+    U16 stack_size;              // Size of stack (must be multiple of 8)
+    U8 is_fresh_task;            // TASK_NEW or TASK_EXISTING
+    U8 is_periodic;              // 0 for regular tasks, 1 for periodic tasks
+    U8 is_static;                // 1 if TCB and stack come from OS_TASK_DEFINE, never freed
+} k_tcb_t;
+
+// Compile time task definition, placed in the .rtx_tasks linker section and
+// started by osKernelInit without any SVC or heap allocation
+typedef struct static_task {
+    k_tcb_t* tcb;                // statically reserved TCB, already holds the initial state
+    U32* stack;                  // statically reserved stack (guard region first in MPU mode)
+    U32 deadline;                // 0 for a plain task, otherwise periodic with this deadline
+} static_task_t;
+
+// guard region sits at the bottom of the reserved stack when MPU guards are on
+#if MPU_STACK_GUARD
+#define STATIC_STACK_GUARD MPU_GUARD_SIZE
+#else
+#define STATIC_STACK_GUARD 0
+#endif
+
+#define OS_TASK_DEFINE(name, entry, stack_bytes, deadline_ms) \
+    _Static_assert((stack_bytes) >= STACK_SIZE && (stack_bytes) % 8 == 0, #name " stack too small or not a multiple of 8"); \
+    static U32 name##_stack[((stack_bytes) + STATIC_STACK_GUARD) / 4] __attribute__((aligned(STATIC_STACK_GUARD > 8 ? STATIC_STACK_GUARD : 8))); \
+    k_tcb_t name##_tcb = { \
+        .ptask = (entry), \
+        .stack_high = (U32)&name##_stack[((stack_bytes) + STATIC_STACK_GUARD) / 4], \
+        .stack_base = name##_stack, \
+        .stack_size = (stack_bytes), \
+        .is_fresh_task = TASK_NEW, \
+        .period = (deadline_ms), \
+        .is_periodic = (deadline_ms) > 0, \
+        .is_static = 1, \
+    }; \
+    static const static_task_t name##_def __attribute__((section(".rtx_tasks"), used)) = { \
+        &name##_tcb, name##_stack, (deadline_ms) \
+    }
+
+// Hot scheduling state, one array per field so the scheduler and tick loops stream through them
+extern U8 g_task_state[MAX_TASKS];        // DORMANT, READY, RUNNING, SLEEPING
+extern U32 g_task_deadline[MAX_TASKS];    // Original deadline/timeslice value
+extern U32 g_task_time_left[MAX_TASKS];   // Time remaining for task
+extern U32 *task_stack_ptrs[MAX_TASKS];   // Saved stack pointer while switched out
+
+// TID to TCB lookup, TCBs come from a pool so free TIDs cost one pointer
+extern k_tcb_t *g_tcb_table[MAX_TASKS];
+
+// TIDs of live tasks (g_num_tasks of them), walked instead of every TID
+extern task_t g_task_list[MAX_TASKS];
+
+extern task_t g_active_task_id;
+
+// TCBs carved from the heap per pool chunk
+#define TCB_POOL_CHUNK 8
+
+// null task stack, it only runs while a task stopped from an interrupt leaves nothing ready
+#define NULL_STACK_WORDS 64
+
+// Scheduler cycle counters (DWT), set SCHED_STATS to 1 to collect them
+#ifndef SCHED_STATS
+#define SCHED_STATS 0
+#endif
+
+typedef struct sched_stats {
+    U32 sched_last;   // cycles spent in the last edf_scheduler call
+    U32 sched_max;
+    U32 tick_last;    // cycles spent in the last SysTick task update
+    U32 tick_max;
+    U32 switches;          // context switches done by PendSV
+    U32 preempt_skipped;   // reschedules refused by a preemption threshold
+} sched_stats_t;
+
+extern sched_stats_t g_sched_stats;
+
+// Time triggered mode, set TT_ENABLED to 1 and link the g_tt_table built by
+// Tools/tt_schedule.py. Table tasks are released by the tick and run ahead
+// of every EDF task until they call osTTYield, EDF fills the remaining time.
+#ifndef TT_ENABLED
+#define TT_ENABLED 0
+#endif
+
+// Per task CPU budgets measured with the DWT cycle counter, set BUDGET_ENFORCE to 1.
+// A task that uses more than its budget within one deadline window is throttled
+// (sleeps out the window) or demoted to background, and osBudgetOverrunHook runs.
+// Windows are counted per task from its creation, one relative deadline each.
+#ifndef BUDGET_ENFORCE
+#define BUDGET_ENFORCE 0
+#endif
+
+#define BUDGET_THROTTLE 0
+#define BUDGET_DEMOTE 1
+
+// deadline a demoted task runs at until its window ends, just ahead of the null task
+#define BUDGET_BACKGROUND_DEADLINE 0xFFFFFFFE
+
+#if BUDGET_ENFORCE
+extern U32 g_task_budget[MAX_TASKS];            // cycles allowed per window, 0 = unlimited
+extern U32 g_task_cycles[MAX_TASKS];            // cycles used in the current window
+extern U32 g_task_budget_overruns[MAX_TASKS];   // windows in which the budget ran out
+
+int osSetBudget(task_t tid, U32 budget_us, U8 policy);
+void osBudgetOverrunHook(task_t tid);
+int budget_tick(void);
+int budget_window_tick(task_t tid);
+#endif
+
+#if TT_ENABLED
+extern k_tcb_t* const g_tt_table[];     // job released on each tick of the hyperperiod, or NULL
+extern const U32 g_tt_table_len;        // hyperperiod in ticks
+extern U32 g_tt_overruns;               // releases that found the previous job still running
+
+void osTTYield(void);
+int tt_tick(void);
+#endif
 
 // functions for Part 1
 void osKernelInit(void);
@@ -28,14 +165,36 @@ int osTaskExit(void);
 // functions for Part 3
 void osSleep(int timeInMs);
 void osPeriodYield(void);
+int osWaitUntilNextPeriod(void);
+int osGetPeriodStats(task_t tid, period_stats_t* stats);
 int osSetDeadline(int deadline, task_t TID);
 int osCreateDeadlineTask(int deadline, TCB* task);
+int osSetPreemptThreshold(task_t tid, U32 threshold);
+
+// Task notifications, a word of event bits per task
+int osNotify(task_t tid, U32 bits);
+U32 osNotifyWait(U32 mask);
+
+// ISR side calls, only from interrupts at or below KERNEL_IRQ_CEILING. They
+// never switch, they set *switch_needed when a more urgent task became ready;
+// hand it to osEndISR as the ISR returns so a single PendSV does the switch.
+int osTaskWakeFromISR(task_t tid, int* switch_needed);
+int osNotifyFromISR(task_t tid, U32 bits, int* switch_needed);
+void osEndISR(int switch_needed);
+
+// Nestable scheduler lock owned by the calling task, interrupts stay enabled
+// but any reschedule they or the owner's wakeups and osYield ask for waits until
+// the outermost unlock. Blocking still switches, the lock only holds again once
+// the owner runs.
+void osSchedLock(void);
+int osSchedUnlock(void);
 
 // Implementation functions for SVC backing
 int osCreateTask_impl(TCB* task);
 int osTaskInfo_impl(task_t tid, TCB* task_copy);
 void osKernelInit_impl(void);
 int osCreateDeadlineTask_impl(int deadline, TCB* task);
+int osCreateServerTask_impl(struct k_cbs* server, TCB* task);
 task_t osGetTID_internal(void);
 
 // Internal scheduler functions
@@ -49,4 +208,18 @@ task_t edf_scheduler(void);
 void update_task_times(void);
 void handle_sleeping_tasks(void);
 
+// Park the running task with no timer (SLEEPING, time_left 0) until k_unblock.
+// k_block_current is entered with the kernel critical section held and releases it;
+// k_unblock needs it held and returns 1 if the woken task should preempt.
+void k_block_current(U32 crit);
+int k_unblock(task_t tid);
+
+// osSleep for a caller that already holds the critical section, releases it like
+// k_block_current; the timer or osTaskWakeFromISR ends it
+void k_sleep_current(U32 crit, U32 ticks);
+
+// Stack usage
+U32 task_stack_high_water(task_t tid);
+void osStackOverflowHook(task_t tid);
+
 #endif /* INC_K_TASK_H_ */
@@ -0,0 +1,87 @@
+/*
+ * k_tasklet.h
+ *
+ *  Stackless cooperative tasklets. A tasklet is a resumable function (a
+ *  protothread) with an EDF deadline; a group of them runs inside one
+ *  ordinary host task that calls osTaskletRun(). Tasklets share the host's
+ *  stack, so each one only costs its tasklet_t plus two heap slots.
+ *
+ *  Locals do not survive a TASKLET_YIELD/SLEEP/WAIT_PERIOD, keep state in
+ *  the struct passed through arg. Any task can start a tasklet on a group;
+ *  a host with nothing to run blocks until one is started or a sleeping
+ *  one is due. Not from ISRs.
+ *
+ *  int blink(tasklet_t* t) {
+ *      TASKLET_BEGIN(t);
+ *      while (1) {
+ *          HAL_GPIO_TogglePin(LD2_GPIO_Port, LD2_Pin);
+ *          TASKLET_WAIT_PERIOD(t);
+ *      }
+ *      TASKLET_END(t);
+ *  }
+ */
+
+#ifndef INC_K_TASKLET_H_
+#define INC_K_TASKLET_H_
+
+#include "common.h"
+
+// what a tasklet body returns to the group scheduler
+#define TASKLET_YIELDED 0   // still ready, same deadline
+#define TASKLET_SLEEP 1     // released again at t->key
+#define TASKLET_PERIOD 2    // released again at the start of its next period
+#define TASKLET_DONE 3      // finished, dropped from the group
+
+typedef struct tasklet tasklet_t;
+typedef int (*tasklet_fn)(tasklet_t* t);
+
+struct tasklet {
+    tasklet_fn fn;          // body
+    void* arg;              // user state, locals don't survive a yield
+    U32 key;                // absolute deadline while ready, wake time while sleeping
+    U32 release;            // start of the current period
+    U32 deadline;           // relative deadline/period in ms
+    U16 resume;             // line to resume at, 0 = start
+    U8 state;               // TASKLET_READY, TASKLET_SLEEPING or TASKLET_FREE
+};
+
+#define TASKLET_FREE 0
+#define TASKLET_READY 1
+#define TASKLET_SLEEPING 2
+
+typedef struct tasklet_group {
+    tasklet_t** ready;      // min heap on absolute deadline
+    tasklet_t** sleeping;   // min heap on wake time
+    U16 n_ready;
+    U16 n_sleeping;
+    U16 n_live;             // started and not done, includes the one running
+    U16 capacity;
+    U32 host_deadline;      // deadline last given to the host task
+    task_t host;            // task running osTaskletRun
+    U8 host_waiting;        // host is blocked or sleeping, osTaskletStart wakes it
+} tasklet_group_t;
+
+// protothread style body macros
+#define TASKLET_BEGIN(t) switch ((t)->resume) { case 0:
+
+#define TASKLET_YIELD(t) \
+    do { (t)->resume = __LINE__; return TASKLET_YIELDED; case __LINE__:; } while (0)
+
+#define TASKLET_SLEEP_MS(t, ms) \
+    do { (t)->key = g_system_time + (ms); (t)->resume = __LINE__; return TASKLET_SLEEP; case __LINE__:; } while (0)
+
+#define TASKLET_WAIT_PERIOD(t) \
+    do { (t)->resume = __LINE__; return TASKLET_PERIOD; case __LINE__:; } while (0)
+
+#define TASKLET_END(t) } (t)->resume = 0; return TASKLET_DONE
+
+// allocates the heaps for up to capacity tasklets
+int osTaskletGroupInit(tasklet_group_t* group, U16 capacity);
+
+// releases a tasklet now with the given relative deadline/period
+int osTaskletStart(tasklet_group_t* group, tasklet_t* t, tasklet_fn fn, void* arg, U32 deadline);
+
+// host task loop, runs the group in EDF order and waits when nothing is ready
+void osTaskletRun(tasklet_group_t* group);
+
+#endif /* INC_K_TASKLET_H_ */
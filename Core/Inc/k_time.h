@@ -0,0 +1,43 @@
+/*
+ * k_time.h
+ *
+ *  64 bit monotonic timebase and microsecond sleeps. Time is counted from
+ *  osKernelInit: whole ticks from SysTick_Handler plus the current
+ *  SysTick->VAL, so reads resolve to one CPU cycle and never wrap.
+ *  Sleeps below the 1 ms tick are timed by a compare on TIM5, the F401's
+ *  free running 32 bit timer, clocked at 1 MHz.
+ */
+
+#ifndef INC_K_TIME_H_
+#define INC_K_TIME_H_
+
+#include "common.h"
+#include "k_crit.h"
+
+// TIM5 interrupt priority, must stay at or below KERNEL_IRQ_CEILING
+#define KTIME_IRQ_PRIORITY (KERNEL_IRQ_CEILING + 1)
+
+// longest single TIM5 wait, longer sleeps are done in pieces
+#define KTIME_MAX_WAIT_US 0x40000000UL
+
+// CPU cycles since osKernelInit
+U64 osTimeNowCycles(void);
+
+// microseconds since osKernelInit
+U64 osTimeNowUs(void);
+
+// block for at least us microseconds
+int osSleepUs(U32 us);
+
+// block until osTimeNowUs() >= abs_us, RTX_ERR if that time has already passed
+int osSleepUntil(U64 abs_us);
+
+// microseconds since g_system_time reached tick, for release jitter
+U32 k_time_us_since_tick(U32 tick);
+
+// kernel side
+void k_time_init(void);
+void k_time_tick(void);
+void k_time_timer_irq(void);
+
+#endif /* INC_K_TIME_H_ */
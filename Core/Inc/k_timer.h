@@ -0,0 +1,80 @@
+/*
+ * k_timer.h
+ *
+ *  Software timers. One shot and periodic callbacks that all run in a
+ *  single timer daemon task, so a blinking LED or a watchdog kick costs a
+ *  os_timer_t instead of a task and its stack. Timers sit in a hashed
+ *  timing wheel of TIMER_WHEEL_SLOTS lists indexed by expiry tick, so
+ *  start and stop are O(1) however many timers exist.
+ *
+ *  static os_timer_t blink;
+ *  osTimerCreate(&blink, toggle_led, NULL, 500);   // every 500 ms
+ *  osTimerStart(&blink, 500);
+ *
+ *  Callbacks run one after another in the daemon, keep them short and never
+ *  block in one. Start and stop are ISR safe.
+ */
+
+#ifndef INC_K_TIMER_H_
+#define INC_K_TIMER_H_
+
+#include "common.h"
+#include "k_task.h"
+
+// 1 = timer daemon and wheel are built in
+#ifndef TIMER_ENABLED
+#define TIMER_ENABLED 0
+#endif
+
+// wheel size, power of two, one list head per slot
+#ifndef TIMER_WHEEL_SLOTS
+#define TIMER_WHEEL_SLOTS 128
+#endif
+
+// EDF deadline of the daemon, 1 runs callbacks ahead of every periodic task
+#ifndef TIMER_DAEMON_DEADLINE
+#define TIMER_DAEMON_DEADLINE 1
+#endif
+
+#ifndef TIMER_DAEMON_STACK
+#define TIMER_DAEMON_STACK 1024
+#endif
+
+typedef void (*os_timer_fn)(void* arg);
+
+typedef struct os_timer {
+    struct os_timer* next;      // slot list
+    struct os_timer** pprev;    // link pointing at this timer, NULL while stopped
+    os_timer_fn fn;
+    void* arg;
+    U32 expires;                // absolute tick (g_system_time)
+    U32 period;                 // reload in ms, 0 = one shot
+} os_timer_t;
+
+#if TIMER_ENABLED
+#if TIMER_WHEEL_SLOTS & (TIMER_WHEEL_SLOTS - 1)
+#error "TIMER_WHEEL_SLOTS must be a power of two"
+#endif
+
+// sets up a stopped timer, period 0 makes it one shot
+int osTimerCreate(os_timer_t* timer, os_timer_fn fn, void* arg, U32 period);
+
+// (re)arms the timer to fire delay_ms from now, a running timer is moved
+int osTimerStart(os_timer_t* timer, U32 delay_ms);
+
+// disarms the timer, RTX_ERR if it was not running
+int osTimerStop(os_timer_t* timer);
+
+// 1 while armed
+int osTimerActive(const os_timer_t* timer);
+
+// SysTick side, wakes the daemon when the current slot has timers
+int k_timer_tick(void);
+
+#if SCHED_STATS
+// worst daemon cycles spent on one slot, callbacks excluded
+extern U32 g_timer_slot_cycles_max;
+#endif
+#endif
+
+#endif /* INC_K_TIMER_H_ */
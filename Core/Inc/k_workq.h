@@ -0,0 +1,105 @@
+/*
+ * k_workq.h
+ *
+ *  Deferred interrupt work. An ISR does the urgent part and posts a
+ *  work_item_t with a deadline; one or more worker tasks running
+ *  osWorkQueueRun() take items earliest deadline first. A worker takes on
+ *  the remaining deadline of the item it runs, so edf_scheduler() orders
+ *  the deferred work against every other task by urgency.
+ *
+ *  static workq_t rx_q;
+ *  static work_item_t rx_work;
+ *
+ *  void USART2_IRQHandler(void) {
+ *      int switch_needed = 0;
+ *      grab_bytes();
+ *      osWorkPostFromISR(&rx_q, &rx_work, 2, &switch_needed);   // parse within 2 ms
+ *      osEndISR(switch_needed);
+ *  }
+ *
+ *  Items are owned by the caller and can be posted again once their
+ *  function has started. A busy worker keeps its item's deadline, so give
+ *  the queue as many workers as work items that must overlap.
+ */
+
+#ifndef INC_K_WORKQ_H_
+#define INC_K_WORKQ_H_
+
+#include "common.h"
+
+// most workers one queue accepts
+#ifndef WORKQ_MAX_WORKERS
+#define WORKQ_MAX_WORKERS 4
+#endif
+
+// most workers in one osWorkerPoolCreate pool
+#ifndef WORKER_POOL_MAX
+#define WORKER_POOL_MAX 8
+#endif
+
+// relative deadline in ms for items posted with deadline 0
+#ifndef WORKQ_DEFAULT_DEADLINE
+#define WORKQ_DEFAULT_DEADLINE 10
+#endif
+
+typedef void (*work_fn)(void* arg);
+
+typedef struct work_item {
+    work_fn fn;
+    void* arg;
+    U32 deadline;               // absolute, g_system_time ticks
+    U8 queued;                  // posted and not yet started
+} work_item_t;
+
+typedef struct workq {
+    work_item_t** heap;         // min heap on absolute deadline
+    U16 count;
+    U16 capacity;
+    U32 overflows;              // posts refused because the queue was full
+    task_t idle[WORKQ_MAX_WORKERS];   // workers blocked waiting for work
+    U8 n_idle;
+    U8 n_workers;               // tasks running osWorkQueueRun on this queue
+} workq_t;
+
+typedef void (*job_fn)(void* job);
+
+// n identical worker tasks sharing one FIFO of job pointers
+typedef struct worker_pool {
+    job_fn fn;                  // run by a worker for every submitted job
+    void** jobs;                // ring of pending jobs
+    U16 head;
+    U16 count;
+    U16 capacity;
+    U32 overflows;              // submits refused because the ring was full
+    task_t workers[WORKER_POOL_MAX];
+    task_t idle[WORKER_POOL_MAX];     // workers blocked waiting for a job
+    U8 n_workers;               // live workers, drops to 0 after a failed create
+    U8 n_idle;
+    U8 dying;                   // create failed, workers exit when they next run
+} worker_pool_t;
+
+// allocates room for up to capacity queued items, call from a task before any ISR posts
+int osWorkQueueInit(workq_t* q, U16 capacity);
+
+void osWorkInit(work_item_t* work, work_fn fn, void* arg);
+
+// queue work due deadline ms from now (0 = WORKQ_DEFAULT_DEADLINE),
+// RTX_ERR if it is already queued or the queue is full
+int osWorkPost(workq_t* q, work_item_t* work, U32 deadline);
+int osWorkPostFromISR(workq_t* q, work_item_t* work, U32 deadline, int* switch_needed);
+
+// worker task loop, runs queued items earliest deadline first and never
+// returns, except RTX_ERR at once if q already has WORKQ_MAX_WORKERS workers
+int osWorkQueueRun(workq_t* q);
+
+// spawns n workers (plain tasks, STACK_SIZE stacks) that each call fn(job)
+// for jobs taken from a shared queue of capacity entries, pool must outlive them;
+// if a spawn fails the queue is freed and the workers already made exit, reuse
+// the pool only once n_workers is back to 0
+int osWorkerPoolCreate(worker_pool_t* pool, U8 n, job_fn fn, U16 capacity);
+
+// queues job for the next free worker, RTX_ERR if the queue is full
+int osWorkerPoolSubmit(worker_pool_t* pool, void* job);
+int osWorkerPoolSubmitFromISR(worker_pool_t* pool, void* job, int* switch_needed);
+
+#endif /* INC_K_WORKQ_H_ */
@@ -0,0 +1,179 @@
+#include "k_cbs.h"
+#include "k_task.h"
+#include "k_crit.h"
+#include "k_syscall.h"
+#include "common.h"
+
+// Define NULL since we can't use standard library
+#ifndef NULL
+#define NULL ((void*)0)
+#endif
+
+// wrap safe time compare
+#define TIME_BEFORE(a, b) ((int)((a) - (b)) < 0)
+
+extern task_t target_task_id;
+
+
+
+// called inside the create SVC, before the task can run
+void k_cbs_attach(k_cbs_t* server, task_t tid) {
+    server->tid = tid;
+    server->remaining = server->budget;
+    server->deadline = g_system_time + server->period;
+    server->postponed = 0;
+    server->pending = 0;
+    server->waiting = 0;
+
+    g_tcb_table[tid]->server = server;
+    g_task_deadline[tid] = server->period;
+    g_task_time_left[tid] = server->period;
+}
+
+
+
+// charges the running server one tick, returns 1 if its deadline moved
+int k_cbs_tick(k_cbs_t* server) {
+    if (server->remaining > 0 && --server->remaining > 0) {
+        return 0;
+    }
+
+    // budget gone, refill it and postpone the deadline by a period; EDF
+    // compares relative deadlines, so hand it what is left until the new one and
+    // restart its slice from there
+    server->remaining = server->budget;
+    server->deadline += server->period;
+    server->postponed++;
+
+    int remaining = (int)(server->deadline - g_system_time);
+    g_task_deadline[server->tid] = remaining < 1 ? 1 : (U32)remaining;
+    g_task_time_left[server->tid] = g_task_deadline[server->tid];
+
+    return 1;
+}
+
+
+
+// CBS arrival rule for a job reaching an idle server, irqs off
+static void cbs_arrival(k_cbs_t* server) {
+    U32 now = g_system_time;
+
+    // keep the old deadline only if the leftover budget fits before it at Q/T
+    if (TIME_BEFORE(now, server->deadline) &&
+        (unsigned long long)server->remaining * server->period <
+        (unsigned long long)(server->deadline - now) * server->budget) {
+        g_task_deadline[server->tid] = server->deadline - now;
+    } else {
+        server->deadline = now + server->period;
+        server->remaining = server->budget;
+        g_task_deadline[server->tid] = server->period;
+    }
+    g_task_time_left[server->tid] = g_task_deadline[server->tid];
+}
+
+
+
+int osCreateServerTask(k_cbs_t* server, U32 budget, U32 period, TCB* task) {
+    if (server == NULL || budget == 0 || budget > period) {
+        return RTX_ERR;
+    }
+    server->budget = budget;
+    server->period = period;
+
+    return (int)k_syscall2(SYS_CREATE_SERVER_TASK, (U32)server, (U32)task);
+}
+
+
+
+void osServerWait(void) {
+    task_t current_task = osGetTID_internal();
+    if (current_task == TID_NULL || g_tcb_table[current_task]->server == NULL) {
+        return;
+    }
+    k_cbs_t* server = g_tcb_table[current_task]->server;
+
+    U32 crit = k_crit_enter();
+
+    if (server->pending == 0) {
+        // SLEEPING with no timer, only osServerSignal wakes it
+        server->waiting = 1;
+        g_task_state[current_task] = SLEEPING;
+        g_task_time_left[current_task] = 0;
+        target_task_id = edf_scheduler();
+
+        k_crit_exit(crit);
+
+        if (target_task_id != TID_NULL) {
+            k_syscall0(SYS_YIELD);
+        } else {
+            while (g_task_state[current_task] == SLEEPING) {
+                __asm("wfi");
+            }
+        }
+
+        crit = k_crit_enter();
+    }
+
+    server->pending--;
+    k_crit_exit(crit);
+}
+
+
+
+static k_cbs_t* server_of(task_t tid) {
+    if (tid == TID_NULL || tid >= MAX_TASKS || g_tcb_table[tid] == NULL) {
+        return NULL;
+    }
+    return g_tcb_table[tid]->server;
+}
+
+
+
+// queues a job and wakes an idle server, returns 1 if it should preempt the running task
+static int cbs_signal(k_cbs_t* server) {
+    task_t current_task = osGetTID_internal();
+    int preempt = 0;
+
+    U32 crit = k_crit_enter();
+
+    server->pending++;
+    if (server->waiting) {
+        server->waiting = 0;
+        cbs_arrival(server);
+        g_task_state[server->tid] = READY;
+        preempt = current_task == TID_NULL ||
+                  g_task_deadline[server->tid] < g_task_deadline[current_task];
+    }
+
+    k_crit_exit(crit);
+
+    return preempt;
+}
+
+
+
+int osServerSignal(task_t tid) {
+    k_cbs_t* server = server_of(tid);
+    if (server == NULL) {
+        return RTX_ERR;
+    }
+
+    if (cbs_signal(server) && osGetTID_internal() != TID_NULL) {
+        osYield();
+    }
+    return RTX_OK;
+}
+
+
+
+int osServerSignalFromISR(task_t tid, int* switch_needed) {
+    k_cbs_t* server = server_of(tid);
+    if (server == NULL) {
+        return RTX_ERR;
+    }
+
+    if (cbs_signal(server) && switch_needed != NULL) {
+        *switch_needed = 1;
+    }
+    return RTX_OK;
+}
@@ -0,0 +1,147 @@
+#include "main.h"
+#include "k_log.h"
+#include "k_task.h"
+#include "common.h"
+
+// ext UART handle from util.c
+extern UART_HandleTypeDef huart2;
+
+#define LOG_BUF_MASK (LOG_BUF_WORDS - 1)
+
+// ring buffer, head is claimed by writers and tail is only moved by k_log_flush
+static U32 log_buf[LOG_BUF_WORDS];
+static volatile U32 log_head = 0;
+static volatile U32 log_tail = 0;
+static volatile U32 log_dropped = 0;
+static U32 log_dropped_reported = 0;
+
+// exclusive load/store so tasks and ISRs can claim slots without masking irqs
+static inline U32 log_ldrex(volatile U32* addr) {
+    U32 result;
+    __asm volatile ("ldrex %0, [%1]" : "=r" (result) : "r" (addr) : "memory");
+    return result;
+}
+
+static inline U32 log_strex(U32 value, volatile U32* addr) {
+    U32 result;
+    __asm volatile ("strex %0, %2, [%1]" : "=&r" (result) : "r" (addr), "r" (value) : "memory");
+    return result;
+}
+
+static inline void log_clrex(void) {
+    __asm volatile ("clrex" ::: "memory");
+}
+
+static inline void log_dmb(void) {
+    __asm volatile ("dmb 0xF" ::: "memory");
+}
+
+
+
+// bumps the drop counter atomically
+static void log_count_drop(void) {
+    U32 dropped;
+    do {
+        dropped = log_ldrex(&log_dropped);
+    } while (log_strex(dropped + 1, &log_dropped));
+}
+
+
+
+// claims words in the ring buffer, returns the start index
+static int log_reserve(U32 words, U32* start) {
+    U32 head;
+
+    do {
+        head = log_ldrex(&log_head);
+
+        // not enough room left before the reader
+        if (head - log_tail + words > LOG_BUF_WORDS) {
+            log_clrex();
+            return RTX_ERR;
+        }
+    } while (log_strex(head + words, &log_head));
+
+    *start = head;
+    return RTX_OK;
+}
+
+
+
+int k_log_write(U32 fmt_id, const U32* args, U32 nargs) {
+    U32 start;
+
+    if (nargs > LOG_MAX_ARGS) {
+        nargs = LOG_MAX_ARGS;
+    }
+
+    if (log_reserve(LOG_HDR_WORDS + nargs, &start) != RTX_OK) {
+        log_count_drop();
+        return RTX_ERR;
+    }
+
+    // fill payload first
+    log_buf[(start + 1) & LOG_BUF_MASK] = fmt_id;
+    log_buf[(start + 2) & LOG_BUF_MASK] = g_system_time;
+    for (U32 i = 0; i < nargs; i++) {
+        log_buf[(start + LOG_HDR_WORDS + i) & LOG_BUF_MASK] = args[i];
+    }
+
+    // header goes in last so the reader never sees a half written record
+    log_dmb();
+    log_buf[start & LOG_BUF_MASK] = ((U32)LOG_MAGIC << 24) | (nargs << 16) | (osGetTID_internal() & 0xFFFF);
+
+    return RTX_OK;
+}
+
+
+
+int k_log_flush(void) {
+    U32 record[LOG_HDR_WORDS + LOG_MAX_ARGS];
+    int sent = 0;
+
+    while (log_tail != log_head) {
+        U32 tail = log_tail;
+        U32 header = log_buf[tail & LOG_BUF_MASK];
+
+        // writer claimed the slot but hasnt committed it yet
+        if ((header >> 24) != LOG_MAGIC) {
+            break;
+        }
+        log_dmb();
+
+        U32 words = LOG_HDR_WORDS + ((header >> 16) & 0xFF);
+        for (U32 i = 0; i < words; i++) {
+            record[i] = log_buf[(tail + i) & LOG_BUF_MASK];
+            // clear every word, a later header can land on an old arg that looks committed
+            log_buf[(tail + i) & LOG_BUF_MASK] = 0;
+        }
+
+        // zeroes have to land before the space goes back to writers
+        log_dmb();
+        log_tail = tail + words;
+
+        HAL_UART_Transmit(&huart2, (U8*)record, words * sizeof(U32), HAL_MAX_DELAY);
+        sent++;
+    }
+
+    // let the host know records went missing
+    U32 dropped = log_dropped;
+    if (dropped != log_dropped_reported) {
+        record[0] = ((U32)LOG_MAGIC << 24) | (1 << 16) | (osGetTID_internal() & 0xFFFF);
+        record[1] = LOG_ID_DROPPED;
+        record[2] = g_system_time;
+        record[3] = dropped - log_dropped_reported;
+        log_dropped_reported = dropped;
+
+        HAL_UART_Transmit(&huart2, (U8*)record, 4 * sizeof(U32), HAL_MAX_DELAY);
+    }
+
+    return sent;
+}
+
+
+
+U32 k_log_dropped(void) {
+    return log_dropped;
+}
@@ -1,6 +1,7 @@
 #include "k_mem.h"
 #include "common.h"
 #include "k_task.h"
+#include "k_syscall.h"
 
 // Ext func for getting TID of task to use without using nested svc calls
 extern task_t osGetTID_internal(void);
@@ -32,6 +33,7 @@ extern U32 _Min_Stack_Size;
 
 // Helper function prototypes
 static mem_block_t* find_free_block(size_t size);
+static mem_block_t* find_free_block_high(size_t size);
 static void split_block(mem_block_t* block, size_t size);
 static void coalesce_free_blocks(mem_block_t* block);
 static void add_to_free_list(mem_block_t* block);
@@ -93,9 +95,7 @@ int k_mem_init_impl(void) {
 }
 
 int k_mem_init(void) {
-    int result;
-    __asm("SVC #7" : "=r" (result));
-    return result;
+    return (int)k_syscall0(SYS_MEM_INIT);
 }
 
 
@@ -103,9 +103,9 @@ int k_mem_init(void) {
 
 
 
-// Allocate memory using First Fit algorithm
+// Allocate memory using First Fit algorithm, or last fit from the top for long lived blocks
 
-void* k_mem_alloc_impl(size_t size) {
+void* k_mem_alloc_hint_impl(size_t size, U8 hint) {
     if (!memory_initialized || size == 0) {
         return NULL;
     }
@@ -118,6 +118,29 @@ void* k_mem_alloc_impl(size_t size) {
     // Space for header
     size_t total_size = size + sizeof(mem_block_t);
 
+    if (hint == MEM_LONG_LIVED) {
+        mem_block_t* block = find_free_block_high(total_size);
+        if (block == NULL) {
+            return NULL;
+        }
+
+        if (block->size >= total_size + sizeof(mem_block_t) + 16) {
+            // carve off the top, the rest stays on the free list where it is
+            block->size -= total_size;
+            block = (mem_block_t*)((U8*)block + block->size);
+            block->size = total_size;
+        } else {
+            remove_from_free_list(block);
+        }
+
+        block->is_allocated = 1;
+        block->owner_tid = osGetTID_internal();
+        block->next = NULL;
+        block->prev = NULL;
+
+        return (void*)((U8*)block + sizeof(mem_block_t));
+    }
+
     // Find free block
     mem_block_t* block = find_free_block(total_size);
     if (block == NULL) {
@@ -158,10 +181,16 @@ void* k_mem_alloc_impl(size_t size) {
     return (void*)((U8*)block + sizeof(mem_block_t));
 }
 
+void* k_mem_alloc_impl(size_t size) {
+    return k_mem_alloc_hint_impl(size, MEM_TRANSIENT);
+}
+
 void* k_mem_alloc(size_t size) {
-    void* result;
-    __asm("SVC #8" : "=r" (result) : "r" (size));
-    return result;
+    return (void*)k_syscall2(SYS_MEM_ALLOC, size, MEM_TRANSIENT);
+}
+
+void* k_mem_alloc_hint(size_t size, U8 hint) {
+    return (void*)k_syscall2(SYS_MEM_ALLOC, size, hint);
 }
 
 
@@ -217,9 +246,24 @@ int k_mem_dealloc_impl(void* ptr) {
 }
 
 int k_mem_dealloc(void* ptr) {
-    int result;
-    __asm("SVC #9" : "=r" (result) : "r" (ptr));
-    return result;
+    return (int)k_syscall1(SYS_MEM_DEALLOC, (U32)ptr);
+}
+
+
+
+// change owner of an allocated block, kernel only
+int k_mem_set_owner(void* ptr, task_t tid) {
+    if (!memory_initialized || ptr == NULL || !is_valid_pointer(ptr)) {
+        return RTX_ERR;
+    }
+
+    mem_block_t* block = (mem_block_t*)((U8*)ptr - sizeof(mem_block_t));
+    if (!block->is_allocated) {
+        return RTX_ERR;
+    }
+
+    block->owner_tid = tid;
+    return RTX_OK;
 }
 
 
@@ -256,9 +300,7 @@ int k_mem_count_extfrag_impl(size_t size) {
 }
 
 int k_mem_count_extfrag(size_t size) {
-    int result;
-    __asm("SVC #10" : "=r" (result) : "r" (size));
-    return result;
+    return (int)k_syscall1(SYS_MEM_EXTFRAG, size);
 }
 
 
@@ -279,6 +321,22 @@ static mem_block_t* find_free_block(size_t size) {
 }
 
 
+// Finds the highest free block that fits, the free list is in address order
+static mem_block_t* find_free_block_high(size_t size) {
+    mem_block_t* found = NULL;
+    mem_block_t* current = free_list_head;
+
+    while (current != NULL) {
+        if (!current->is_allocated && current->size >= size) {
+            found = current;
+        }
+        current = current->next;
+    }
+
+    return found;
+}
+
+
 // Split block into 2 if larger than needed
 static void split_block(mem_block_t* block, size_t size) {
     if (block->size < size + sizeof(mem_block_t) + 16) {
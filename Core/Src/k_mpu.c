@@ -0,0 +1,55 @@
+#include "main.h"
+#include "k_mpu.h"
+#include "common.h"
+
+// RASR size field for the guard, log2(MPU_GUARD_SIZE) - 1
+#define MPU_GUARD_RASR_SIZE (__builtin_ctz(MPU_GUARD_SIZE) - 1)
+
+// no access, never executable. This CMSIS ARM_MPU_RASR drops the size and
+// enable fields, without them the region stays off, so they are added here
+#define MPU_GUARD_RASR (ARM_MPU_RASR(1, ARM_MPU_AP_NONE, 0, 0, 0, 0, 0x00, 0) | \
+                        ((MPU_GUARD_RASR_SIZE << MPU_RASR_SIZE_Pos) & MPU_RASR_SIZE_Msk) | \
+                        MPU_RASR_ENABLE_Msk)
+
+volatile U32 g_mpu_switch_cycles = 0;
+volatile U32 g_mpu_switch_cycles_max = 0;
+
+
+
+// background map for privileged code, memfault enabled, cycle counter on for overhead numbers
+void k_mpu_init(void) {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    ARM_MPU_Disable();
+    for (U32 i = 0; i < 8; i++) {
+        ARM_MPU_ClrRegion(i);
+    }
+
+    SCB->SHCSR |= SCB_SHCSR_MEMFAULTENA_Msk;
+    ARM_MPU_Enable(MPU_CTRL_PRIVDEFENA_Msk);
+
+    g_mpu_switch_cycles = 0;
+    g_mpu_switch_cycles_max = 0;
+}
+
+
+
+// moves the no-access guard region under the incoming task's stack, called from PendSV
+void k_mpu_set_stack_guard(U32 guard_base) {
+    U32 start = DWT->CYCCNT;
+
+    if (guard_base == 0) {
+        ARM_MPU_ClrRegion(MPU_GUARD_REGION);
+    } else {
+        ARM_MPU_SetRegion(ARM_MPU_RBAR(MPU_GUARD_REGION, guard_base), MPU_GUARD_RASR);
+    }
+    __DSB();
+    __ISB();
+
+    g_mpu_switch_cycles = DWT->CYCCNT - start;
+    if (g_mpu_switch_cycles > g_mpu_switch_cycles_max) {
+        g_mpu_switch_cycles_max = g_mpu_switch_cycles;
+    }
+}
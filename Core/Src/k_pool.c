@@ -0,0 +1,90 @@
+#include "k_pool.h"
+#include "k_mem.h"
+#include "k_crit.h"
+#include "common.h"
+
+// Define NULL since we can't use standard library
+#ifndef NULL
+#define NULL ((void*)0)
+#endif
+
+
+
+void k_pool_init(k_pool_t* pool, U32 obj_size, U32 per_chunk) {
+    // need room for the free list link and word alignment
+    if (obj_size < sizeof(void*)) {
+        obj_size = sizeof(void*);
+    }
+    if (obj_size % 4 != 0) {
+        obj_size += 4 - (obj_size % 4);
+    }
+
+    pool->free_list = NULL;
+    pool->obj_size = obj_size;
+    pool->per_chunk = per_chunk > 0 ? per_chunk : 1;
+    pool->in_use = 0;
+    pool->capacity = 0;
+}
+
+
+
+// carve another chunk out of the heap and thread it onto the free list
+static int k_pool_grow(k_pool_t* pool) {
+    // chunks are only returned by a heap reset
+    U8* chunk = (U8*)k_mem_alloc_hint_impl(pool->obj_size * pool->per_chunk, MEM_LONG_LIVED);
+    if (chunk == NULL) {
+        return RTX_ERR;
+    }
+
+    // chunks belong to the kernel, not whichever task made the call
+    k_mem_set_owner(chunk, TID_NULL);
+
+    // thread the chunk on its own, then splice it in while ISRs are held off
+    void* head = NULL;
+    void** tail = (void**)chunk;
+    for (U32 i = 0; i < pool->per_chunk; i++) {
+        void** obj = (void**)(chunk + i * pool->obj_size);
+        *obj = head;
+        head = obj;
+    }
+
+    U32 crit = k_crit_enter();
+    *tail = pool->free_list;
+    pool->free_list = head;
+    pool->capacity += pool->per_chunk;
+    k_crit_exit(crit);
+
+    return RTX_OK;
+}
+
+
+
+void* k_pool_alloc(k_pool_t* pool) {
+    if (pool->free_list == NULL && k_pool_grow(pool) != RTX_OK) {
+        return NULL;
+    }
+
+    U32 crit = k_crit_enter();
+    void** obj = (void**)pool->free_list;
+    if (obj != NULL) {
+        pool->free_list = *obj;
+        pool->in_use++;
+    }
+    k_crit_exit(crit);
+
+    return obj;
+}
+
+
+
+void k_pool_free(k_pool_t* pool, void* obj) {
+    if (obj == NULL) {
+        return;
+    }
+
+    U32 crit = k_crit_enter();
+    *(void**)obj = pool->free_list;
+    pool->free_list = obj;
+    pool->in_use--;
+    k_crit_exit(crit);
+}
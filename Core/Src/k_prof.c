@@ -0,0 +1,126 @@
+#include "main.h"
+#include "k_prof.h"
+#include "k_task.h"
+#include "common.h"
+#include <stdio.h>
+
+// ext linker symbols
+extern U32 _etext;
+
+#define PROF_TEXT_START 0x08000000UL
+
+// histogram state
+static U16 prof_buckets[PROF_BUCKETS];
+static U32 prof_task_samples[MAX_TASKS];
+static U32 prof_isr_samples = 0;
+static U32 prof_other_samples = 0;
+static U32 prof_total_samples = 0;
+static U32 prof_shift = 0;
+static volatile U8 prof_running = 0;
+
+
+
+// pick the smallest power of 2 bucket width that covers all of .text
+void k_prof_init(void) {
+    U32 text_size = (U32)&_etext - PROF_TEXT_START;
+
+    prof_shift = 1;
+    while ((text_size >> prof_shift) >= PROF_BUCKETS) {
+        prof_shift++;
+    }
+
+    k_prof_reset();
+    prof_running = 1;
+}
+
+void k_prof_start(void) {
+    prof_running = 1;
+}
+
+void k_prof_stop(void) {
+    prof_running = 0;
+}
+
+void k_prof_reset(void) {
+    U8 was_running = prof_running;
+    prof_running = 0;
+
+    for (int i = 0; i < PROF_BUCKETS; i++) {
+        prof_buckets[i] = 0;
+    }
+    for (int i = 0; i < MAX_TASKS; i++) {
+        prof_task_samples[i] = 0;
+    }
+    prof_isr_samples = 0;
+    prof_other_samples = 0;
+    prof_total_samples = 0;
+
+    prof_running = was_running;
+}
+
+
+
+void k_prof_tick(void) {
+    if (!prof_running) {
+        return;
+    }
+
+    prof_total_samples++;
+
+    // another handler was interrupted, its frame is on MSP not PSP
+    if ((SCB->ICSR & SCB_ICSR_RETTOBASE_Msk) == 0) {
+        prof_isr_samples++;
+        return;
+    }
+
+    // stacked PC is word 6 of the exception frame on the task stack
+    U32* frame = (U32*)__get_PSP();
+    if (frame == NULL) {
+        prof_other_samples++;
+        return;
+    }
+    U32 pc = frame[6];
+
+    task_t tid = osGetTID_internal();
+    if (tid < MAX_TASKS) {
+        prof_task_samples[tid]++;
+    }
+
+    U32 bucket = (pc - PROF_TEXT_START) >> prof_shift;
+    if (pc < PROF_TEXT_START || bucket >= PROF_BUCKETS) {
+        prof_other_samples++;
+        return;
+    }
+
+    // saturate instead of wrapping
+    if (prof_buckets[bucket] != 0xFFFF) {
+        prof_buckets[bucket]++;
+    }
+}
+
+
+
+// output format is parsed by Tools/prof_report.py
+void k_prof_dump(void) {
+    U8 was_running = prof_running;
+    prof_running = 0;
+
+    printf("PROF BEGIN base=0x%08lx shift=%lu total=%lu isr=%lu other=%lu\r\n",
+           PROF_TEXT_START, prof_shift, prof_total_samples, prof_isr_samples, prof_other_samples);
+
+    for (int i = 0; i < MAX_TASKS; i++) {
+        if (prof_task_samples[i] != 0) {
+            printf("PROF T %d %lu\r\n", i, prof_task_samples[i]);
+        }
+    }
+
+    for (int i = 0; i < PROF_BUCKETS; i++) {
+        if (prof_buckets[i] != 0) {
+            printf("PROF B 0x%08lx %u\r\n", PROF_TEXT_START + ((U32)i << prof_shift), prof_buckets[i]);
+        }
+    }
+
+    printf("PROF END\r\n");
+
+    prof_running = was_running;
+}
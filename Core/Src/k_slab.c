@@ -0,0 +1,94 @@
+#include "main.h"
+#include "k_slab.h"
+#include "k_task.h"
+#include "common.h"
+
+// Define NULL since we can't use standard library
+#ifndef NULL
+#define NULL ((void*)0)
+#endif
+
+#if STACK_SLAB_COUNT
+
+// the stride is size + guard, so only the first slot is aligned unless the size is too
+#if STATIC_STACK_GUARD && STACK_SLAB_SIZE % STATIC_STACK_GUARD != 0
+#error "STACK_SLAB_SIZE must be a multiple of MPU_GUARD_SIZE"
+#endif
+
+#define SLAB_WORDS ((STACK_SLAB_COUNT + 31) / 32)
+#define SLAB_SLOT_WORDS ((STACK_SLAB_SIZE + STATIC_STACK_GUARD) / 4)
+#define SLAB_ALIGN (STATIC_STACK_GUARD > 8 ? STATIC_STACK_GUARD : 8)
+
+// slots are aligned for the MPU guard like OS_TASK_DEFINE stacks
+static U32 slab[STACK_SLAB_COUNT][SLAB_SLOT_WORDS] __attribute__((aligned(SLAB_ALIGN)));
+
+// 1 = free, one bit per slot
+static U32 slab_free[SLAB_WORDS];
+static U32 slab_in_use;
+
+U32 g_stack_slab_misses = 0;
+
+
+
+void k_stack_slab_init(void) {
+    // a misplaced slab would put every guard off its MPU region boundary
+    if ((U32)slab % SLAB_ALIGN != 0) {
+        Error_Handler();
+    }
+
+    for (int i = 0; i < SLAB_WORDS; i++) {
+        slab_free[i] = 0xFFFFFFFF;
+    }
+    // bits past the last slot never come free
+    if (STACK_SLAB_COUNT % 32 != 0) {
+        slab_free[SLAB_WORDS - 1] = (1UL << (STACK_SLAB_COUNT % 32)) - 1;
+    }
+    slab_in_use = 0;
+    g_stack_slab_misses = 0;
+}
+
+
+
+// only called from system calls, which never nest, so no critical section
+void* k_stack_slab_alloc(void) {
+    for (int i = 0; i < SLAB_WORDS; i++) {
+        if (slab_free[i] != 0) {
+            U32 bit = __builtin_ctz(slab_free[i]);
+            slab_free[i] &= ~(1UL << bit);
+            slab_in_use++;
+            return slab[i * 32 + bit];
+        }
+    }
+
+    g_stack_slab_misses++;
+    return NULL;
+}
+
+
+
+int k_stack_slab_owns(const void* stack) {
+    U32 offset = (U32)stack - (U32)slab;
+    return (U32)stack >= (U32)slab && offset < sizeof(slab) && offset % sizeof(slab[0]) == 0;
+}
+
+
+
+int k_stack_slab_free(void* stack) {
+    if (!k_stack_slab_owns(stack)) {
+        return RTX_ERR;
+    }
+
+    U32 slot = ((U32)stack - (U32)slab) / sizeof(slab[0]);
+    slab_free[slot / 32] |= 1UL << (slot % 32);
+    slab_in_use--;
+
+    return RTX_OK;
+}
+
+
+
+U32 k_stack_slab_in_use(void) {
+    return slab_in_use;
+}
+
+#endif
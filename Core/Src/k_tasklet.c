@@ -0,0 +1,222 @@
+#include "k_tasklet.h"
+#include "k_task.h"
+#include "k_mem.h"
+#include "k_crit.h"
+#include "common.h"
+
+// Define NULL since we can't use standard library
+#ifndef NULL
+#define NULL ((void*)0)
+#endif
+
+// wrap safe time compare
+#define TIME_BEFORE(a, b) ((int)((a) - (b)) < 0)
+
+
+
+// min heap helpers, both heaps are keyed on tasklet_t.key, callers hold the kernel critical section
+static void heap_push(tasklet_t** heap, U16* count, tasklet_t* t) {
+    U16 i = (*count)++;
+
+    while (i > 0) {
+        U16 parent = (i - 1) / 2;
+        if (!TIME_BEFORE(t->key, heap[parent]->key)) {
+            break;
+        }
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = t;
+}
+
+static tasklet_t* heap_pop(tasklet_t** heap, U16* count) {
+    tasklet_t* top = heap[0];
+    tasklet_t* last = heap[--(*count)];
+    U16 n = *count;
+    U16 i = 0;
+
+    // sift the last element down from the root
+    while (1) {
+        U16 child = 2 * i + 1;
+        if (child >= n) {
+            break;
+        }
+        if (child + 1 < n && TIME_BEFORE(heap[child + 1]->key, heap[child]->key)) {
+            child++;
+        }
+        if (!TIME_BEFORE(heap[child]->key, last->key)) {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    if (n > 0) {
+        heap[i] = last;
+    }
+
+    return top;
+}
+
+
+
+int osTaskletGroupInit(tasklet_group_t* group, U16 capacity) {
+    if (group == NULL || capacity == 0) {
+        return RTX_ERR;
+    }
+
+    // one allocation for both heaps
+    tasklet_t** heaps = (tasklet_t**)k_mem_alloc_hint(2 * capacity * sizeof(tasklet_t*), MEM_LONG_LIVED);
+    if (heaps == NULL) {
+        return RTX_ERR;
+    }
+
+    group->ready = heaps;
+    group->sleeping = heaps + capacity;
+    group->n_ready = 0;
+    group->n_sleeping = 0;
+    group->n_live = 0;
+    group->capacity = capacity;
+    group->host_deadline = 0;
+    group->host = TID_NULL;
+    group->host_waiting = 0;
+
+    return RTX_OK;
+}
+
+
+
+int osTaskletStart(tasklet_group_t* group, tasklet_t* t, tasklet_fn fn, void* arg, U32 deadline) {
+    if (group == NULL || t == NULL || fn == NULL || deadline == 0) {
+        return RTX_ERR;
+    }
+
+    int preempt = 0;
+    U32 crit = k_crit_enter();
+
+    // the running tasklet is in neither heap but still needs its slot back
+    if (group->n_live >= group->capacity) {
+        k_crit_exit(crit);
+        return RTX_ERR;
+    }
+    group->n_live++;
+
+    t->fn = fn;
+    t->arg = arg;
+    t->deadline = deadline;
+    t->resume = 0;
+    t->release = g_system_time;
+    t->key = t->release + deadline;
+    t->state = TASKLET_READY;
+
+    heap_push(group->ready, &group->n_ready, t);
+
+    // the ready heap was empty, so the host runs at this tasklet's deadline
+    if (group->host_waiting) {
+        group->host_waiting = 0;
+        group->host_deadline = deadline;
+        g_task_deadline[group->host] = deadline;
+
+        // blocked on an empty group, or sleeping until the next wake time
+        preempt = k_unblock(group->host);
+        osTaskWakeFromISR(group->host, &preempt);
+    }
+
+    k_crit_exit(crit);
+
+    if (preempt && osGetTID_internal() != TID_NULL) {
+        osYield();
+    }
+    return RTX_OK;
+}
+
+
+
+// move every tasklet whose wake time has passed to the ready heap
+static void tasklet_release_due(tasklet_group_t* group, U32 now) {
+    while (group->n_sleeping > 0 && !TIME_BEFORE(now, group->sleeping[0]->key)) {
+        tasklet_t* t = heap_pop(group->sleeping, &group->n_sleeping);
+
+        // latest period start at or before the wake time, so a TASKLET_SLEEP_MS
+        // keeps the tasklet on its original period grid
+        t->release += ((t->key - t->release) / t->deadline) * t->deadline;
+        t->key = t->release + t->deadline;
+        t->state = TASKLET_READY;
+        heap_push(group->ready, &group->n_ready, t);
+    }
+}
+
+
+
+// host inherits the earliest tasklet deadline so EDF between tasks still holds
+static void tasklet_update_host_deadline(tasklet_group_t* group, tasklet_t* t, U32 now) {
+    int remaining = (int)(t->key - now);
+    if (remaining < 1) {
+        remaining = 1;
+    }
+
+    // only pay for the SVC when the deadline actually changes
+    if ((U32)remaining != group->host_deadline) {
+        group->host_deadline = remaining;
+        osSetDeadline(remaining, osGetTID_internal());
+    }
+}
+
+
+
+void osTaskletRun(tasklet_group_t* group) {
+    group->host = osGetTID_internal();
+
+    while (1) {
+        U32 crit = k_crit_enter();
+        U32 now = g_system_time;
+        tasklet_release_due(group, now);
+
+        // nothing ready, block until a tasklet is started or the next one is due
+        if (group->n_ready == 0) {
+            group->host_waiting = 1;
+            if (group->n_sleeping == 0) {
+                k_block_current(crit);
+            } else {
+                int wait = (int)(group->sleeping[0]->key - now);
+                k_sleep_current(crit, wait < 1 ? 1 : wait);
+            }
+
+            // woken by the timer, osTaskletStart clears the flag itself
+            crit = k_crit_enter();
+            group->host_waiting = 0;
+            k_crit_exit(crit);
+            continue;
+        }
+
+        tasklet_t* t = heap_pop(group->ready, &group->n_ready);
+        k_crit_exit(crit);
+
+        tasklet_update_host_deadline(group, t, now);
+        int result = t->fn(t);
+
+        crit = k_crit_enter();
+        switch (result) {
+            case TASKLET_YIELDED:
+                heap_push(group->ready, &group->n_ready, t);
+                break;
+
+            case TASKLET_SLEEP:
+                t->state = TASKLET_SLEEPING;
+                heap_push(group->sleeping, &group->n_sleeping, t);
+                break;
+
+            case TASKLET_PERIOD:
+                // drift free, next release is a whole period after this one
+                t->key = t->release + t->deadline;
+                t->state = TASKLET_SLEEPING;
+                heap_push(group->sleeping, &group->n_sleeping, t);
+                break;
+
+            default:
+                t->state = TASKLET_FREE;
+                group->n_live--;
+                break;
+        }
+        k_crit_exit(crit);
+    }
+}
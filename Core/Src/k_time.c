@@ -0,0 +1,219 @@
+#include "main.h"
+#include "k_time.h"
+#include "k_task.h"
+#include "k_crit.h"
+#include "common.h"
+
+// wrap safe compare of TIM5 counts, true once a has reached b
+#define COUNT_REACHED(a, b) ((int)((a) - (b)) >= 0)
+
+// whole SysTick periods since k_time_init
+static volatile U64 time_ticks = 0;
+
+// tasks waiting on TIM5, sorted by wake time, linked through wait_next
+static U32 wake_at[MAX_TASKS];
+static U16 wait_next[MAX_TASKS];
+static U16 wait_head = TID_NULL;
+
+
+
+void k_time_init(void) {
+    time_ticks = 0;
+    wait_head = TID_NULL;
+
+    // timer kernel clock is twice PCLK1 whenever APB1 is divided
+    U32 clk = HAL_RCC_GetPCLK1Freq();
+    if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_CFGR_PPRE1_DIV1) {
+        clk *= 2;
+    }
+
+    // free running 32 bit counter at 1 MHz, CC1 is the wake up compare
+    __HAL_RCC_TIM5_CLK_ENABLE();
+    TIM5->CR1 = 0;
+    TIM5->PSC = clk / 1000000 - 1;
+    TIM5->ARR = 0xFFFFFFFF;
+    TIM5->CNT = 0;
+    TIM5->DIER = 0;
+    TIM5->EGR = TIM_EGR_UG;
+    TIM5->SR = 0;
+    TIM5->CR1 = TIM_CR1_CEN;
+
+    NVIC_SetPriority(TIM5_IRQn, KTIME_IRQ_PRIORITY);
+    NVIC_EnableIRQ(TIM5_IRQn);
+}
+
+
+
+// called from SysTick_Handler on every tick, kernel running or not
+void k_time_tick(void) {
+    time_ticks++;
+}
+
+
+
+// consistent (ticks, cycles into the tick) pair
+static void time_read(U64* ticks, U32* sub) {
+    U32 load = SysTick->LOAD;
+    U64 t1;
+    U64 t2;
+    U32 val;
+
+    do {
+        t1 = time_ticks;
+        val = SysTick->VAL;
+        // counter already wrapped but the tick is still pending (SysTick masked)
+        if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) {
+            val = SysTick->VAL;
+            t1++;
+            t2 = time_ticks + 1;
+        } else {
+            t2 = time_ticks;
+        }
+    } while (t1 != t2);
+
+    *ticks = t1;
+    *sub = load - val;
+}
+
+U64 osTimeNowCycles(void) {
+    U64 ticks;
+    U32 sub;
+    time_read(&ticks, &sub);
+    return ticks * (SysTick->LOAD + 1) + sub;
+}
+
+// tick boundaries are the release instants of the ms timebase
+U32 k_time_us_since_tick(U32 tick) {
+    U32 load = SysTick->LOAD;
+    U32 t1;
+    U32 t2;
+    U32 val;
+
+    do {
+        t1 = g_system_time;
+        val = SysTick->VAL;
+        if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) {
+            val = SysTick->VAL;
+            t1++;
+            t2 = g_system_time + 1;
+        } else {
+            t2 = g_system_time;
+        }
+    } while (t1 != t2);
+
+    return (t1 - tick) * 1000 + (load - val) / (SystemCoreClock / 1000000);
+}
+
+U64 osTimeNowUs(void) {
+    U64 ticks;
+    U32 sub;
+    time_read(&ticks, &sub);
+    // tick is 1 ms, no 64 bit division needed
+    return ticks * 1000 + sub / (SystemCoreClock / 1000000);
+}
+
+
+
+// points CC1 at the first waiter, or turns the interrupt off
+static void arm_compare(void) {
+    if (wait_head == TID_NULL) {
+        TIM5->DIER &= ~TIM_DIER_CC1IE;
+        return;
+    }
+
+    TIM5->CCR1 = wake_at[wait_head];
+    TIM5->SR = ~TIM_SR_CC1IF;
+    TIM5->DIER |= TIM_DIER_CC1IE;
+
+    // compare already behind the counter, raise the event by hand
+    if (COUNT_REACHED(TIM5->CNT, wake_at[wait_head])) {
+        TIM5->EGR = TIM_EGR_CC1G;
+    }
+}
+
+
+
+// blocks the running task for us microseconds of TIM5 time
+static void timer_wait(U32 us) {
+    task_t current_task = osGetTID_internal();
+
+    // before osKernelStart there is nothing to switch to
+    if (current_task == TID_NULL) {
+        U32 start = TIM5->CNT;
+        while (TIM5->CNT - start < us) {
+        }
+        return;
+    }
+
+    U32 crit = k_crit_enter();
+    U32 at = TIM5->CNT + us;
+    wake_at[current_task] = at;
+
+    U16* link = &wait_head;
+    while (*link != TID_NULL && COUNT_REACHED(at, wake_at[*link])) {
+        link = &wait_next[*link];
+    }
+    wait_next[current_task] = *link;
+    *link = current_task;
+
+    if (wait_head == current_task) {
+        arm_compare();
+    }
+
+    // TIM5 is held off until the critical section is dropped in here
+    k_block_current(crit);
+}
+
+
+
+int osSleepUs(U32 us) {
+    while (us > KTIME_MAX_WAIT_US) {
+        timer_wait(KTIME_MAX_WAIT_US);
+        us -= KTIME_MAX_WAIT_US;
+    }
+    if (us > 0) {
+        timer_wait(us);
+    }
+    return RTX_OK;
+}
+
+
+
+int osSleepUntil(U64 abs_us) {
+    U64 now = osTimeNowUs();
+    if (abs_us <= now) {
+        return RTX_ERR;
+    }
+
+    while (abs_us - now > KTIME_MAX_WAIT_US) {
+        timer_wait(KTIME_MAX_WAIT_US);
+        now = osTimeNowUs();
+    }
+    if (abs_us > now) {
+        timer_wait((U32)(abs_us - now));
+    }
+    return RTX_OK;
+}
+
+
+
+// TIM5 CC1, wakes every waiter that is due and re-arms for the next one
+void k_time_timer_irq(void) {
+    int switch_needed = 0;
+
+    U32 crit = k_crit_enter();
+    TIM5->SR = ~TIM_SR_CC1IF;
+
+    U32 now = TIM5->CNT;
+    while (wait_head != TID_NULL && COUNT_REACHED(now, wake_at[wait_head])) {
+        task_t tid = wait_head;
+        wait_head = wait_next[tid];
+        if (k_unblock(tid)) {
+            switch_needed = 1;
+        }
+    }
+    arm_compare();
+    k_crit_exit(crit);
+
+    osEndISR(switch_needed);
+}
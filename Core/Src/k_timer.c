@@ -0,0 +1,199 @@
+#include "main.h"
+#include "k_timer.h"
+#include "k_task.h"
+#include "k_crit.h"
+#include "common.h"
+
+// Define NULL since we can't use standard library
+#ifndef NULL
+#define NULL ((void*)0)
+#endif
+
+#if TIMER_ENABLED
+
+#define TIMER_SLOT(tick) ((tick) & (TIMER_WHEEL_SLOTS - 1))
+
+// hashed timing wheel, a slot holds every timer whose expiry maps to it
+// whatever the round, the daemon skips the ones due on a later lap
+static os_timer_t* wheel[TIMER_WHEEL_SLOTS];
+
+// next tick the daemon has to process, never ahead of g_system_time + 1
+static U32 cursor = 0;
+
+// daemon is blocked, SysTick moves the cursor when it wakes it
+static volatile U8 daemon_waiting = 0;
+
+#if SCHED_STATS
+U32 g_timer_slot_cycles_max = 0;
+#endif
+
+static void timer_daemon_main(void* args);
+
+OS_TASK_DEFINE(timer_daemon, &timer_daemon_main, TIMER_DAEMON_STACK, TIMER_DAEMON_DEADLINE);
+
+
+
+// list helpers, callers hold the kernel critical section
+static void wheel_insert(os_timer_t* timer) {
+    os_timer_t** head = &wheel[TIMER_SLOT(timer->expires)];
+
+    timer->next = *head;
+    if (timer->next != NULL) {
+        timer->next->pprev = &timer->next;
+    }
+    timer->pprev = head;
+    *head = timer;
+}
+
+static void wheel_remove(os_timer_t* timer) {
+    *timer->pprev = timer->next;
+    if (timer->next != NULL) {
+        timer->next->pprev = timer->pprev;
+    }
+    timer->pprev = NULL;
+}
+
+
+
+int osTimerCreate(os_timer_t* timer, os_timer_fn fn, void* arg, U32 period) {
+    if (timer == NULL || fn == NULL) {
+        return RTX_ERR;
+    }
+
+    timer->next = NULL;
+    timer->pprev = NULL;
+    timer->fn = fn;
+    timer->arg = arg;
+    timer->expires = 0;
+    timer->period = period;
+
+    return RTX_OK;
+}
+
+
+
+int osTimerStart(os_timer_t* timer, U32 delay_ms) {
+    if (timer == NULL || timer->fn == NULL || delay_ms == 0) {
+        return RTX_ERR;
+    }
+
+    U32 crit = k_crit_enter();
+    if (timer->pprev != NULL) {
+        wheel_remove(timer);
+    }
+    // always a future tick, so SysTick sees its slot before it is due
+    timer->expires = g_system_time + delay_ms;
+    wheel_insert(timer);
+    k_crit_exit(crit);
+
+    return RTX_OK;
+}
+
+
+
+int osTimerStop(os_timer_t* timer) {
+    if (timer == NULL) {
+        return RTX_ERR;
+    }
+
+    U32 crit = k_crit_enter();
+    int result = RTX_ERR;
+    if (timer->pprev != NULL) {
+        wheel_remove(timer);
+        result = RTX_OK;
+    }
+    k_crit_exit(crit);
+
+    return result;
+}
+
+
+
+int osTimerActive(const os_timer_t* timer) {
+    return timer != NULL && timer->pprev != NULL;
+}
+
+
+
+// runs inside SysTick_Handler, one slot lookup per tick
+int k_timer_tick(void) {
+    if (!daemon_waiting || wheel[TIMER_SLOT(g_system_time)] == NULL) {
+        return 0;
+    }
+
+    // every slot passed while the daemon slept was empty on its tick
+    cursor = g_system_time;
+    daemon_waiting = 0;
+    return k_unblock(timer_daemon_tcb.tid);
+}
+
+
+
+static void timer_daemon_main(void* args) {
+    while (1) {
+        U32 crit = k_crit_enter();
+
+        // caught up with the tick, sleep until a slot with timers comes round
+        if ((int)(cursor - g_system_time) > 0) {
+            daemon_waiting = 1;
+            k_block_current(crit);
+            continue;
+        }
+
+#if SCHED_STATS
+        U32 spent = 0;
+        U32 start_cycles = DWT->CYCCNT;
+#endif
+
+        // detach the slot so callbacks can start and stop timers freely,
+        // a stop from a callback or an ISR unlinks from the batch itself
+        os_timer_t* batch = wheel[TIMER_SLOT(cursor)];
+        wheel[TIMER_SLOT(cursor)] = NULL;
+        if (batch != NULL) {
+            batch->pprev = &batch;
+        }
+
+        while (batch != NULL) {
+            os_timer_t* timer = batch;
+            wheel_remove(timer);
+
+            // same slot, later lap
+            if (timer->expires != cursor) {
+                wheel_insert(timer);
+                continue;
+            }
+
+            // periodic timers are rearmed before the callback so it can stop them
+            if (timer->period != 0) {
+                timer->expires += timer->period;
+                wheel_insert(timer);
+            }
+
+            os_timer_fn fn = timer->fn;
+            void* arg = timer->arg;
+
+#if SCHED_STATS
+            spent += DWT->CYCCNT - start_cycles;
+#endif
+            k_crit_exit(crit);
+            fn(arg);
+            crit = k_crit_enter();
+#if SCHED_STATS
+            start_cycles = DWT->CYCCNT;
+#endif
+        }
+
+        cursor++;
+
+#if SCHED_STATS
+        spent += DWT->CYCCNT - start_cycles;
+        if (spent > g_timer_slot_cycles_max) {
+            g_timer_slot_cycles_max = spent;
+        }
+#endif
+
+        k_crit_exit(crit);
+    }
+}
+
+#endif
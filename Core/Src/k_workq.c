@@ -0,0 +1,365 @@
+#include "k_workq.h"
+#include "k_task.h"
+#include "k_mem.h"
+#include "k_crit.h"
+#include "common.h"
+
+// Define NULL since we can't use standard library
+#ifndef NULL
+#define NULL ((void*)0)
+#endif
+
+// wrap safe time compare
+#define TIME_BEFORE(a, b) ((int)((a) - (b)) < 0)
+
+
+
+// min heap on work_item_t.deadline, callers hold the kernel critical section
+static void heap_push(workq_t* q, work_item_t* work) {
+    U16 i = q->count++;
+
+    while (i > 0) {
+        U16 parent = (i - 1) / 2;
+        if (!TIME_BEFORE(work->deadline, q->heap[parent]->deadline)) {
+            break;
+        }
+        q->heap[i] = q->heap[parent];
+        i = parent;
+    }
+    q->heap[i] = work;
+}
+
+static work_item_t* heap_pop(workq_t* q) {
+    work_item_t* top = q->heap[0];
+    work_item_t* last = q->heap[--q->count];
+    U16 n = q->count;
+    U16 i = 0;
+
+    // sift the last element down from the root
+    while (1) {
+        U16 child = 2 * i + 1;
+        if (child >= n) {
+            break;
+        }
+        if (child + 1 < n && TIME_BEFORE(q->heap[child + 1]->deadline, q->heap[child]->deadline)) {
+            child++;
+        }
+        if (!TIME_BEFORE(q->heap[child]->deadline, last->deadline)) {
+            break;
+        }
+        q->heap[i] = q->heap[child];
+        i = child;
+    }
+    if (n > 0) {
+        q->heap[i] = last;
+    }
+
+    return top;
+}
+
+
+
+// relative deadline a worker needs to run the earliest item on time
+static U32 head_deadline(workq_t* q) {
+    int remaining = (int)(q->heap[0]->deadline - g_system_time);
+    return remaining < 1 ? 1 : (U32)remaining;
+}
+
+
+
+int osWorkQueueInit(workq_t* q, U16 capacity) {
+    if (q == NULL || capacity == 0) {
+        return RTX_ERR;
+    }
+
+    work_item_t** heap = (work_item_t**)k_mem_alloc_hint(capacity * sizeof(work_item_t*), MEM_LONG_LIVED);
+    if (heap == NULL) {
+        return RTX_ERR;
+    }
+
+    q->heap = heap;
+    q->count = 0;
+    q->capacity = capacity;
+    q->overflows = 0;
+    q->n_idle = 0;
+    q->n_workers = 0;
+
+    return RTX_OK;
+}
+
+
+
+void osWorkInit(work_item_t* work, work_fn fn, void* arg) {
+    work->fn = fn;
+    work->arg = arg;
+    work->deadline = 0;
+    work->queued = 0;
+}
+
+
+
+// queues the item and hands it to an idle worker, *preempt set if that worker should run now
+static int work_post(workq_t* q, work_item_t* work, U32 deadline, int* preempt) {
+    if (q == NULL || q->heap == NULL || work == NULL || work->fn == NULL) {
+        return RTX_ERR;
+    }
+    if (deadline == 0) {
+        deadline = WORKQ_DEFAULT_DEADLINE;
+    }
+
+    U32 crit = k_crit_enter();
+
+    if (work->queued || q->count >= q->capacity) {
+        if (!work->queued) {
+            q->overflows++;
+        }
+        k_crit_exit(crit);
+        return RTX_ERR;
+    }
+
+    work->deadline = g_system_time + deadline;
+    work->queued = 1;
+    heap_push(q, work);
+
+    if (q->n_idle > 0) {
+        task_t worker = q->idle[--q->n_idle];
+        g_task_deadline[worker] = head_deadline(q);
+        *preempt = k_unblock(worker);
+    }
+
+    k_crit_exit(crit);
+
+    return RTX_OK;
+}
+
+
+
+int osWorkPost(workq_t* q, work_item_t* work, U32 deadline) {
+    int preempt = 0;
+    int result = work_post(q, work, deadline, &preempt);
+
+    if (preempt && osGetTID_internal() != TID_NULL) {
+        osYield();
+    }
+    return result;
+}
+
+
+
+int osWorkPostFromISR(workq_t* q, work_item_t* work, U32 deadline, int* switch_needed) {
+    int preempt = 0;
+    int result = work_post(q, work, deadline, &preempt);
+
+    if (preempt && switch_needed != NULL) {
+        *switch_needed = 1;
+    }
+    return result;
+}
+
+
+
+int osWorkQueueRun(workq_t* q) {
+    task_t current_task = osGetTID_internal();
+    if (q == NULL || q->heap == NULL || current_task == TID_NULL) {
+        return RTX_ERR;
+    }
+
+    // every worker needs an idle slot to block in, turn the extra ones away
+    U32 crit = k_crit_enter();
+    if (q->n_workers >= WORKQ_MAX_WORKERS) {
+        k_crit_exit(crit);
+        return RTX_ERR;
+    }
+    q->n_workers++;
+    k_crit_exit(crit);
+
+    // the worker's own deadline, in force again between items
+    U32 base_deadline = g_task_deadline[current_task];
+
+    while (1) {
+        crit = k_crit_enter();
+
+        if (q->count == 0) {
+            // SLEEPING with no timer, work_post wakes it
+            q->idle[q->n_idle++] = current_task;
+            k_block_current(crit);
+            continue;
+        }
+
+        // run at the item's urgency, EDF takes the worker away if something
+        // more urgent is ready once the deadline gets later
+        U32 old_deadline = g_task_deadline[current_task];
+        U32 new_deadline = head_deadline(q);
+        work_item_t* work = heap_pop(q);
+        work_fn fn = work->fn;
+        void* arg = work->arg;
+        work->queued = 0;
+        g_task_deadline[current_task] = new_deadline;
+
+        k_crit_exit(crit);
+
+        if (new_deadline > old_deadline) {
+            osYield();
+        }
+
+        fn(arg);
+
+        // item done, drop its urgency
+        crit = k_crit_enter();
+        U32 item_deadline = g_task_deadline[current_task];
+        g_task_deadline[current_task] = base_deadline;
+        k_crit_exit(crit);
+
+        if (base_deadline > item_deadline) {
+            osYield();
+        }
+    }
+}
+
+
+
+// pool worker entry, the pool arrives in R0 through the task's args
+static void pool_worker(void* args) {
+    worker_pool_t* pool = (worker_pool_t*)args;
+    task_t current_task = osGetTID_internal();
+
+    while (1) {
+        U32 crit = k_crit_enter();
+
+        if (pool->dying) {
+            pool->n_workers--;
+            k_crit_exit(crit);
+            osTaskExit();
+        }
+
+        if (pool->count == 0) {
+            // SLEEPING with no timer, pool_submit wakes it
+            pool->idle[pool->n_idle++] = current_task;
+            k_block_current(crit);
+            continue;
+        }
+
+        void* job = pool->jobs[pool->head];
+        pool->head = (pool->head + 1) % pool->capacity;
+        pool->count--;
+
+        k_crit_exit(crit);
+
+        pool->fn(job);
+    }
+}
+
+
+
+// a spawn failed: no more jobs are taken, workers exit the next time they run
+static void pool_unwind(worker_pool_t* pool) {
+    int preempt = 0;
+    U32 crit = k_crit_enter();
+
+    void** jobs = pool->jobs;
+    pool->jobs = NULL;
+    pool->count = 0;
+    pool->dying = 1;
+    while (pool->n_idle > 0) {
+        preempt |= k_unblock(pool->idle[--pool->n_idle]);
+    }
+
+    k_crit_exit(crit);
+
+    k_mem_dealloc(jobs);
+    if (preempt && osGetTID_internal() != TID_NULL) {
+        osYield();
+    }
+}
+
+
+
+int osWorkerPoolCreate(worker_pool_t* pool, U8 n, job_fn fn, U16 capacity) {
+    if (pool == NULL || fn == NULL || n == 0 || n > WORKER_POOL_MAX || capacity == 0) {
+        return RTX_ERR;
+    }
+
+    void** jobs = (void**)k_mem_alloc_hint(capacity * sizeof(void*), MEM_LONG_LIVED);
+    if (jobs == NULL) {
+        return RTX_ERR;
+    }
+
+    pool->fn = fn;
+    pool->jobs = jobs;
+    pool->head = 0;
+    pool->count = 0;
+    pool->capacity = capacity;
+    pool->overflows = 0;
+    pool->n_workers = 0;
+    pool->n_idle = 0;
+    pool->dying = 0;
+
+    TCB task;
+    task.ptask = pool_worker;
+    task.args = pool;
+    task.stack_size = STACK_SIZE;
+
+    for (U8 i = 0; i < n; i++) {
+        if (osCreateTask(&task) != RTX_OK) {
+            pool_unwind(pool);
+            return RTX_ERR;
+        }
+        U32 crit = k_crit_enter();
+        pool->workers[pool->n_workers++] = task.tid;
+        k_crit_exit(crit);
+    }
+
+    return RTX_OK;
+}
+
+
+
+// queues the job and wakes an idle worker, *preempt set if that worker should run now
+static int pool_submit(worker_pool_t* pool, void* job, int* preempt) {
+    if (pool == NULL || pool->jobs == NULL) {
+        return RTX_ERR;
+    }
+
+    U32 crit = k_crit_enter();
+
+    if (pool->count >= pool->capacity) {
+        pool->overflows++;
+        k_crit_exit(crit);
+        return RTX_ERR;
+    }
+
+    pool->jobs[(pool->head + pool->count) % pool->capacity] = job;
+    pool->count++;
+
+    if (pool->n_idle > 0) {
+        *preempt = k_unblock(pool->idle[--pool->n_idle]);
+    }
+
+    k_crit_exit(crit);
+
+    return RTX_OK;
+}
+
+
+
+int osWorkerPoolSubmit(worker_pool_t* pool, void* job) {
+    int preempt = 0;
+    int result = pool_submit(pool, job, &preempt);
+
+    if (preempt && osGetTID_internal() != TID_NULL) {
+        osYield();
+    }
+    return result;
+}
+
+
+
+int osWorkerPoolSubmitFromISR(worker_pool_t* pool, void* job, int* switch_needed) {
+    int preempt = 0;
+    int result = pool_submit(pool, job, &preempt);
+
+    if (preempt && switch_needed != NULL) {
+        *switch_needed = 1;
+    }
+    return result;
+}
@@ -1,18 +1,55 @@
 
 
+#include "main.h"
 #include "k_task.h"
 #include "k_mem.h"
+#include "k_timer.h"
 #include "common.h"
 
+// 1 = A, B and C never preempt each other (threshold 4), compare the
+// SCHED_STATS switch counts printed by TaskA with this on and off
+#ifndef DEMO_THRESHOLD
+#define DEMO_THRESHOLD 0
+#endif
+
+// 1 = arm BENCH_TIMERS periodic software timers and print what a start, a
+// stop and one wheel slot cost with all of them live (needs TIMER_ENABLED)
+#ifndef DEMO_TIMER_BENCH
+#define DEMO_TIMER_BENCH 0
+#endif
+
+#if DEMO_TIMER_BENCH && !TIMER_ENABLED
+#error "DEMO_TIMER_BENCH needs TIMER_ENABLED"
+#endif
 
 
 int i_test = 0;
 int i_test2 = 0;
 
+extern k_tcb_t task_a_tcb, task_b_tcb, task_c_tcb;
+
 void TaskA(void ) {
+#if SCHED_STATS
+   int periods = 0;
+#endif
    while(1){
       printf("%d, %d\r\n", i_test, i_test2);
-      osPeriodYield();
+#if SCHED_STATS
+      // once a second: switches, refused preemptions, stack high water marks
+      // and how late A's 4 ms releases start
+      if (++periods == 250) {
+         periods = 0;
+         printf("sw %lu skip %lu hwm %lu %lu %lu jit %lu/%lu us over %lu\r\n",
+                g_sched_stats.switches, g_sched_stats.preempt_skipped,
+                task_stack_high_water(task_a_tcb.tid),
+                task_stack_high_water(task_b_tcb.tid),
+                task_stack_high_water(task_c_tcb.tid),
+                task_a_tcb.period_stats.jitter_last_us,
+                task_a_tcb.period_stats.jitter_max_us,
+                task_a_tcb.period_stats.overruns);
+      }
+#endif
+      osWaitUntilNextPeriod();
    }
 }
 
@@ -30,6 +67,73 @@ void TaskC(void *) {
    }
 }
 
+#if DEMO_TIMER_BENCH
+#define BENCH_TIMERS 2000
+#define BENCH_PROBES 100
+
+static volatile U32 bench_fired = 0;
+
+static void bench_callback(void* arg) {
+   bench_fired++;
+}
+
+void TimerBench(void* args) {
+   os_timer_t* timers = k_mem_alloc_hint(BENCH_TIMERS * sizeof(os_timer_t), MEM_LONG_LIVED);
+   if (timers == NULL) {
+      printf("bench: no memory for %d timers\r\n", BENCH_TIMERS);
+      osTaskExit();
+   }
+
+   CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+   DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+   // periods spread over 10..1009 ms so every slot carries several laps
+   for (int i = 0; i < BENCH_TIMERS; i++) {
+      osTimerCreate(&timers[i], bench_callback, NULL, 10 + i % 1000);
+      osTimerStart(&timers[i], 1 + i % 1000);
+   }
+
+   os_timer_t probe;
+   osTimerCreate(&probe, bench_callback, NULL, 0);
+
+   while (1) {
+      U32 start_sum = 0, start_max = 0, stop_sum = 0, stop_max = 0;
+
+      for (int i = 0; i < BENCH_PROBES; i++) {
+         U32 c0 = DWT->CYCCNT;
+         osTimerStart(&probe, 1 + i * 7);
+         U32 c1 = DWT->CYCCNT;
+         osTimerStop(&probe);
+         U32 c2 = DWT->CYCCNT;
+
+         start_sum += c1 - c0;
+         stop_sum += c2 - c1;
+         if (c1 - c0 > start_max) {
+            start_max = c1 - c0;
+         }
+         if (c2 - c1 > stop_max) {
+            stop_max = c2 - c1;
+         }
+      }
+
+      printf("timers %d fired %lu start %lu/%lu stop %lu/%lu cyc (avg/max)\r\n",
+             BENCH_TIMERS, bench_fired,
+             start_sum / BENCH_PROBES, start_max, stop_sum / BENCH_PROBES, stop_max);
+#if SCHED_STATS
+      printf("slot max %lu cyc\r\n", g_timer_slot_cycles_max);
+#endif
+      osSleep(1000);
+   }
+}
+
+OS_TASK_DEFINE(timer_bench, &TimerBench, STACK_SIZE, 0);
+#endif
+
+// demo task set, started by osKernelInit without touching the heap
+OS_TASK_DEFINE(task_a, (void (*)(void*))&TaskA, STACK_SIZE, 4);
+OS_TASK_DEFINE(task_b, (void (*)(void*))&TaskB, STACK_SIZE, 4);
+OS_TASK_DEFINE(task_c, &TaskC, STACK_SIZE, 12);
+
 int main(void) {
 
     HAL_Init();
@@ -40,20 +144,13 @@ int main(void) {
 
     osKernelInit();
 
-    printf("Reset\r\n");
-
-
-    TCB st_mytask;
+#if DEMO_THRESHOLD
+    osSetPreemptThreshold(task_a_tcb.tid, 4);
+    osSetPreemptThreshold(task_b_tcb.tid, 4);
+    osSetPreemptThreshold(task_c_tcb.tid, 4);
+#endif
 
-    st_mytask.stack_size = STACK_SIZE;
-    st_mytask.ptask = &TaskA;
-    osCreateDeadlineTask(4, &st_mytask);
-
-    st_mytask.ptask = &TaskB;
-    osCreateDeadlineTask(4, &st_mytask);
-
-    st_mytask.ptask = &TaskC;
-    osCreateDeadlineTask(12, &st_mytask);
+    printf("Reset\r\n");
 
     osKernelStart();
 
@@ -1,5 +1,14 @@
 #include "k_task.h"
 #include "k_mem.h"
+#include "k_prof.h"
+#include "k_mpu.h"
+#include "k_pool.h"
+#include "k_cbs.h"
+#include "k_crit.h"
+#include "k_syscall.h"
+#include "k_shared.h"
+#include "k_time.h"
+#include "k_slab.h"
 #include "common.h"
 #include <stdbool.h>
 
@@ -60,39 +69,83 @@ static inline void __disable_irq(void) {
 
 
 
-
-static inline void __enable_irq(void) {
-    __asm volatile ("cpsie i" : : : "memory");
-}
-
-
-
-
 // Global var
-TCB g_tasks[MAX_TASKS];
-task_t g_active_task_id = TID_NULL;
+k_tcb_t *g_tcb_table[MAX_TASKS];   // TID to TCB lookup, NULL while the TID is free
+task_t g_task_list[MAX_TASKS];     // live tasks, scheduler and tick loops only walk these
+KSHARED U8 g_task_state[MAX_TASKS];
+U32 g_task_deadline[MAX_TASKS];
+U32 g_task_time_left[MAX_TASKS];
+KSHARED task_t g_active_task_id;
 task_t target_task_id = TID_NULL;
 U32 *task_stack_ptrs[MAX_TASKS];
+U32 *task_stack_limits[MAX_TASKS];   // lowest usable stack word, guard region sits right below it in MPU mode
 int g_num_tasks = 0;
 U8 g_kernel_initialized = 0;
 U8 g_kernel_running = 0;
-volatile U32 g_system_time = 0;
+KSHARED volatile U32 g_system_time;
+sched_stats_t g_sched_stats;
+
+// TCB pool and free TIDs so create and exit never scan MAX_TASKS
+static k_pool_t tcb_pool;
+static k_tcb_t null_tcb;
+static U32 null_stack[NULL_STACK_WORDS] __attribute__((aligned(8)));
+static U16 task_list_pos[MAX_TASKS];
+static task_t tid_free_stack[MAX_TASKS];
+static U32 tid_free_top = 0;
+
+// task notifications, mask is what a blocked osNotifyWait waits for (0 = not waiting)
+static U32 task_notify_bits[MAX_TASKS];
+static U32 task_notify_mask[MAX_TASKS];
+
+// osSchedLock nesting per task and a reschedule that arrived while locked,
+// the lock only holds while its owner is the running task
+static U32 task_lock_depth[MAX_TASKS];
+static volatile U8 sched_pending = 0;
+
+#if BUDGET_ENFORCE
+U32 g_task_budget[MAX_TASKS];
+U32 g_task_cycles[MAX_TASKS];
+U32 g_task_budget_overruns[MAX_TASKS];
+static U32 task_saved_deadline[MAX_TASKS];   // real deadline while demoted
+static U32 task_window_left[MAX_TASKS];      // ticks to the end of the budget window
+static U8 task_budget_flags[MAX_TASKS];
+static U32 budget_stamp = 0;                 // CYCCNT when the active task was last charged
+
+#define BUDGET_FLAG_DEMOTE 0x01              // policy, clear = throttle
+#define BUDGET_FLAG_HIT 0x02                 // budget already ran out this window
+#define BUDGET_FLAG_DEMOTED 0x04             // running at BUDGET_BACKGROUND_DEADLINE
+#endif
+
+#if TT_ENABLED
+// time triggered dispatch, next table slot and the job it last released
+U32 g_tt_overruns = 0;
+static U32 tt_slot = 0;
+static task_t tt_current = TID_NULL;
+#endif
 
 // ext declarations
 extern volatile U32 g_system_time;
+extern uint32_t SystemCoreClock;
+
+// OS_TASK_DEFINE table from the linker script
+extern const static_task_t __rtx_tasks_start[];
+extern const static_task_t __rtx_tasks_end[];
 
 // ext functions
 extern void start_first_task(void);
 extern void perform_context_switch(void);
+static void init_task_frame(task_t tid);
+
+// system handler priority bytes (SHPR2/SHPR3)
+#define SHPR_SVCALL (*(volatile uint8_t *)0xE000ED1FUL)
+#define SHPR_PENDSV (*(volatile uint8_t *)0xE000ED22UL)
+#define SHPR_SYSTICK (*(volatile uint8_t *)0xE000ED23UL)
+#define PRIO_BYTE(p) ((uint8_t)((p) << (8 - KERNEL_PRIO_BITS)))
 
-// mem block struct
-typedef struct mem_block {
-    U32 size;
-    U8 is_allocated;
-    task_t owner_tid;
-    struct mem_block* next;
-    struct mem_block* prev;
-} mem_block_t;
+// DWT cycle counter for scheduler stats
+#define DEMCR (*(volatile uint32_t *)0xE000EDFCUL)
+#define DWT_CTRL (*(volatile uint32_t *)0xE0001000UL)
+#define DWT_CYCCNT (*(volatile uint32_t *)0xE0001004UL)
 
 //  null task that just yields more efficiently
 void null_task_func(void *args) {
@@ -104,34 +157,162 @@ void null_task_func(void *args) {
 
 
 
+// add to the end of the live task list
+static void task_list_add(task_t tid) {
+    task_list_pos[tid] = g_num_tasks;
+    g_task_list[g_num_tasks] = tid;
+    g_num_tasks++;
+}
+
+// swap the last live task into the hole so removal stays O(1)
+static void task_list_remove(task_t tid) {
+    U16 pos = task_list_pos[tid];
+    task_t last = g_task_list[g_num_tasks - 1];
+
+    g_task_list[pos] = last;
+    task_list_pos[last] = pos;
+    g_num_tasks--;
+}
+
+
+
+// fill a fresh stack with the paint pattern so usage can be measured later
+static void paint_task_stack(void* base, U32 size) {
+    U32* word = (U32*)base;
+    for (U32 i = 0; i < size / 4; i++) {
+        word[i] = STACK_PAINT;
+    }
+}
+
+// peak stack usage in bytes, found by scanning up from the bottom for the first overwritten word
+U32 task_stack_high_water(task_t tid) {
+    if (tid == TID_NULL || tid >= MAX_TASKS || task_stack_limits[tid] == NULL) {
+        return 0;
+    }
+
+    U32* word = task_stack_limits[tid];
+    U32* top = (U32*)g_tcb_table[tid]->stack_high;
+    while (word < top && *word == STACK_PAINT) {
+        word++;
+    }
+
+    return (U32)top - (U32)word;
+}
+
+// checks the saved stack pointer and the guard words at the bottom of the stack
+static U8 task_stack_overflowed(task_t tid, U32* sp) {
+    U32* base = task_stack_limits[tid];
+    if (base == NULL) {
+        return 0;
+    }
+
+    if (sp < base + STACK_GUARD_WORDS) {
+        return 1;
+    }
+    for (int i = 0; i < STACK_GUARD_WORDS; i++) {
+        if (base[i] != STACK_PAINT) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// called from PendSV when a task has blown its stack, override to log or recover
+__attribute__((weak)) void osStackOverflowHook(task_t tid) {
+    __disable_irq();
+    while (1) {
+    }
+}
+
+
+
+
+// brings up every OS_TASK_DEFINE task, TCB and stack are already reserved so no heap is touched
+static void start_static_tasks(void) {
+    for (const static_task_t* def = __rtx_tasks_start; def < __rtx_tasks_end; def++) {
+        if (tid_free_top == 0) {
+            return;
+        }
+
+        task_t tid = tid_free_stack[--tid_free_top];
+        k_tcb_t* tcb = def->tcb;
+
+        tcb->tid = tid;
+        tcb->is_fresh_task = TASK_NEW;
+        g_tcb_table[tid] = tcb;
+
+        task_stack_limits[tid] = (U32*)((U8*)def->stack + STATIC_STACK_GUARD);
+        paint_task_stack(task_stack_limits[tid], tcb->stack_size);
+
+        g_task_state[tid] = READY;
+        g_task_deadline[tid] = def->deadline > 0 ? def->deadline : 5;
+        tcb->next_period_start = 0;
+        g_task_time_left[tid] = g_task_deadline[tid];
+
+        task_list_add(tid);
+    }
+}
+
+
 
 // implementation for oskerenlinit where set everything up to clean initial state
 void osKernelInit_impl(void) {
 
 	// clear everything and start dormant
     for (int i = 0; i < MAX_TASKS; i++) {
-        g_tasks[i].state = DORMANT;
-        g_tasks[i].tid = i;
-        g_tasks[i].ptask = NULL;
-        g_tasks[i].stack_high = 0;
-        g_tasks[i].stack_size = 0;
-        g_tasks[i].stack_ptr = NULL;
-        g_tasks[i].is_fresh_task = TASK_NEW;
-        g_tasks[i].time_left = 0;
-        g_tasks[i].deadline_value = 5;
-        g_tasks[i].sleep_time = 0;
-        g_tasks[i].period = 0;
-        g_tasks[i].next_period_start = 0;
-        g_tasks[i].is_periodic = 0;
+        g_task_state[i] = DORMANT;
+        g_task_time_left[i] = 0;
+        g_task_deadline[i] = 5;
+        g_tcb_table[i] = NULL;
         task_stack_ptrs[i] = NULL;
+        task_stack_limits[i] = NULL;
+        task_notify_bits[i] = 0;
+        task_notify_mask[i] = 0;
+        task_lock_depth[i] = 0;
+#if BUDGET_ENFORCE
+        g_task_budget[i] = 0;
+        g_task_cycles[i] = 0;
+        g_task_budget_overruns[i] = 0;
+        task_budget_flags[i] = 0;
+        task_window_left[i] = 0;
+#endif
+    }
+
+    sched_pending = 0;
+
+#if TT_ENABLED
+    tt_slot = 0;
+    tt_current = TID_NULL;
+    g_tt_overruns = 0;
+#endif
+
+    // SVC and SysTick share the kernel ceiling so they never preempt each other,
+    // PendSV switches last, anything above the ceiling is never masked
+    SHPR_SVCALL = PRIO_BYTE(KERNEL_IRQ_CEILING);
+    SHPR_SYSTICK = PRIO_BYTE(KERNEL_IRQ_CEILING);
+    SHPR_PENDSV = PRIO_BYTE(KERNEL_PRIO_LOWEST);
+
+    // free TIDs popped lowest first
+    tid_free_top = 0;
+    for (task_t i = MAX_TASKS - 1; i > TID_NULL; i--) {
+        tid_free_stack[tid_free_top++] = i;
     }
 
-    //  null task setup
-    g_tasks[0].state = READY;
-    g_tasks[0].ptask = &null_task_func;
-    g_tasks[0].deadline_value = 0xFFFFFFFF;
-    g_tasks[0].time_left = 0xFFFFFFFF;
-    g_tasks[0].is_periodic = 0;
+    //  null task setup, it never leaves the table
+    null_tcb.tid = TID_NULL;
+    null_tcb.ptask = &null_task_func;
+    null_tcb.stack_high = (U32)&null_stack[NULL_STACK_WORDS];
+    null_tcb.stack_base = NULL;
+    null_tcb.server = NULL;
+    null_tcb.preempt_threshold = 0;
+    null_tcb.stack_size = sizeof(null_stack);
+    null_tcb.is_fresh_task = TASK_NEW;
+    null_tcb.is_periodic = 0;
+    null_tcb.is_static = 1;
+    g_tcb_table[0] = &null_tcb;
+    g_task_state[0] = READY;
+    g_task_deadline[0] = 0xFFFFFFFF;
+    g_task_time_left[0] = 0xFFFFFFFF;
 
     // reset all global state
     g_num_tasks = 0;
@@ -143,32 +324,75 @@ void osKernelInit_impl(void) {
     if (k_mem_init_impl() != RTX_OK) {
 
     }
+
+    // heap was just reset so the pool starts empty
+    k_pool_init(&tcb_pool, sizeof(k_tcb_t), TCB_POOL_CHUNK);
+#if STACK_SLAB_COUNT
+    k_stack_slab_init();
+#endif
+
+    start_static_tasks();
+
+#if BUDGET_ENFORCE
+    DEMCR |= (1UL << 24);
+    DWT_CTRL |= 1UL;
+    budget_stamp = DWT_CYCCNT;
+#endif
+
+#if SCHED_STATS
+    DEMCR |= (1UL << 24);
+    DWT_CYCCNT = 0;
+    DWT_CTRL |= 1UL;
+    g_sched_stats.sched_last = 0;
+    g_sched_stats.sched_max = 0;
+    g_sched_stats.tick_last = 0;
+    g_sched_stats.tick_max = 0;
+    g_sched_stats.switches = 0;
+    g_sched_stats.preempt_skipped = 0;
+#endif
+
+#if PROF_ENABLED
+    k_prof_init();
+#endif
+
+    k_time_init();
+
+#if MPU_STACK_GUARD
+    k_mpu_init();
+#endif
 }
 
 void osKernelInit(void) {
-    __asm("SVC #18");
+    k_syscall0(SYS_KERNEL_INIT);
 }
 
 //  scheduler that handles both periodic and non periodic
 task_t edf_scheduler(void) {
+#if SCHED_STATS
+    U32 start_cycles = DWT_CYCCNT;
+#endif
+#if TT_ENABLED
+    // a released table job owns the CPU until it calls osTTYield, unless it
+    // blocks in osSleep or a wait, then EDF runs the rest until it is ready again
+    if (tt_current != TID_NULL &&
+        (g_task_state[tt_current] == READY || g_task_state[tt_current] == RUNNING)) {
+        return tt_current;
+    }
+#endif
     U32 earliest_deadline = 0xFFFFFFFF;
     task_t selected_task = 0;
     int tasks_with_same_deadline = 0;
-    task_t first_equal_deadline_task = TID_NULL;
 
-    // find the earlest deadline
-    for (task_t i = 1; i < MAX_TASKS; i++) {
-        if (g_tasks[i].state == READY) {
-            if (g_tasks[i].deadline_value < earliest_deadline) {
-                earliest_deadline = g_tasks[i].deadline_value;
+    // find the earlest deadline, only live tasks are on the list
+    for (int k = 0; k < g_num_tasks; k++) {
+        task_t i = g_task_list[k];
+        if (g_task_state[i] == READY) {
+            if (g_task_deadline[i] < earliest_deadline) {
+                earliest_deadline = g_task_deadline[i];
                 selected_task = i;
                 tasks_with_same_deadline = 1;
-                first_equal_deadline_task = i;
-            } else if (g_tasks[i].deadline_value == earliest_deadline) {
+            } else if (g_task_deadline[i] == earliest_deadline) {
                 tasks_with_same_deadline++;
-                if (first_equal_deadline_task == TID_NULL) {
-                    first_equal_deadline_task = i;
-                }
             }
         }
     }
@@ -177,21 +401,31 @@ task_t edf_scheduler(void) {
     if (tasks_with_same_deadline > 1) {
     	task_t current_task = osGetTID_internal();
 
-        // next task with same deadline after current task
-        for (task_t i = current_task + 1; i < MAX_TASKS; i++) {
-            if (g_tasks[i].state == READY && g_tasks[i].deadline_value == earliest_deadline) {
-                return i;
-            }
+        // start looking right after the current task in list order
+        int k = 0;
+        if (current_task != TID_NULL && g_tcb_table[current_task] != NULL) {
+            k = task_list_pos[current_task] + 1;
         }
 
-        // if didn't find one after current then look before
-        for (task_t i = 1; i <= current_task; i++) {
-            if (g_tasks[i].state == READY && g_tasks[i].deadline_value == earliest_deadline) {
-                return i;
+        for (int n = 0; n < g_num_tasks; n++, k++) {
+            if (k >= g_num_tasks) {
+                k = 0;
+            }
+            task_t i = g_task_list[k];
+            if (g_task_state[i] == READY && g_task_deadline[i] == earliest_deadline) {
+                selected_task = i;
+                break;
             }
         }
     }
 
+#if SCHED_STATS
+    g_sched_stats.sched_last = DWT_CYCCNT - start_cycles;
+    if (g_sched_stats.sched_last > g_sched_stats.sched_max) {
+        g_sched_stats.sched_max = g_sched_stats.sched_last;
+    }
+#endif
+
     // return 0
     return selected_task;
 }
@@ -205,277 +439,374 @@ task_t edf_scheduler(void) {
 
 // Context switch handler
 void perform_context_switch(void) {
+	// PendSV is the lowest priority, keep SysTick out while the switch is decided
+	U32 crit = k_crit_enter();
 	task_t current_task = osGetTID_internal();
 
+#if BUDGET_ENFORCE
+    // charge the outgoing task up to the switch, the incoming one starts from here
+    U32 now = DWT_CYCCNT;
+    if (current_task != TID_NULL) {
+        g_task_cycles[current_task] += now - budget_stamp;
+    }
+    budget_stamp = now;
+#endif
+
     // save where current task stack pointer is
     if (current_task != TID_NULL) {
 
         task_stack_ptrs[current_task] = (U32*)__get_PSP();
+
+        // the heap block below the stack is already damaged if this trips
+        if (g_task_state[current_task] != DORMANT &&
+            task_stack_overflowed(current_task, task_stack_ptrs[current_task])) {
+            osStackOverflowHook(current_task);
+        }
     }
 
     // get next task stack pointer and make it the current task
     if (target_task_id != TID_NULL) {
+#if SCHED_STATS
+        if (target_task_id != current_task) {
+            g_sched_stats.switches++;
+        }
+#endif
         __set_PSP((uint32_t)task_stack_ptrs[target_task_id]);
         g_active_task_id = target_task_id;
+
+#if MPU_STACK_GUARD
+        k_mpu_set_stack_guard((U32)task_stack_limits[target_task_id] - MPU_GUARD_SIZE);
+#endif
+    } else if (current_task != TID_NULL) {
+        // the current task was stopped from an interrupt and nothing is ready,
+        // wait in a fresh null task frame until the tick readies something
+        init_task_frame(TID_NULL);
+        __set_PSP((uint32_t)task_stack_ptrs[TID_NULL]);
+        g_active_task_id = TID_NULL;
     }
-}
 
-// Trigger context switch
-void trigger_context_switch(void) {
+    k_crit_exit(crit);
+}
 
+// slab first when the stack fits, *limit gets the lowest usable word above the guard
+static void* alloc_task_stack(U16 stack_size, U32* limit) {
+#if STACK_SLAB_COUNT
+    if (stack_size <= STACK_SLAB_SIZE) {
+        void* slot = k_stack_slab_alloc();
+        if (slot != NULL) {
+            *limit = (U32)slot + STATIC_STACK_GUARD;
+            return slot;
+        }
+    }
+#endif
 
-	task_t current_task = osGetTID_internal();
+#if MPU_STACK_GUARD
+    // extra room to align the guard region and for the guard itself
+    void* allocated_stack = k_mem_alloc_hint_impl(stack_size + 2 * MPU_GUARD_SIZE, MEM_LONG_LIVED);
+    // guard base has to be aligned to its own size
+    *limit = (((U32)allocated_stack + MPU_GUARD_SIZE - 1) & ~(MPU_GUARD_SIZE - 1)) + MPU_GUARD_SIZE;
+#else
+    void* allocated_stack = k_mem_alloc_hint_impl(stack_size, MEM_LONG_LIVED);
+    *limit = (U32)allocated_stack;
+#endif
+    return allocated_stack;
+}
 
-    target_task_id = edf_scheduler();
+static int stack_from_slab(void* stack) {
+#if STACK_SLAB_COUNT
+    return k_stack_slab_owns(stack);
+#else
+    return 0;
+#endif
+}
 
-    if (target_task_id == TID_NULL || target_task_id == current_task) {
+static void free_task_stack(void* stack) {
+#if STACK_SLAB_COUNT
+    if (k_stack_slab_free(stack) == RTX_OK) {
         return;
     }
+#endif
+    k_mem_dealloc_impl(stack);
+}
 
-    // sets up new task
-    if (g_tasks[target_task_id].is_fresh_task == TASK_NEW) {
-        task_stack_ptrs[target_task_id] = (U32 *)g_tasks[target_task_id].stack_high;
-
-        // For xPSR, PC and LR
-        *(--task_stack_ptrs[target_task_id]) = (1 << 24);
-        *(--task_stack_ptrs[target_task_id]) = (U32)(g_tasks[target_task_id].ptask);
-        *(--task_stack_ptrs[target_task_id]) = (U32)(osTaskExit);
+// first frame of a new task, popped like any switched out task, entry gets args in R0
+static void init_task_frame(task_t tid) {
+    U32* sp = (U32*)g_tcb_table[tid]->stack_high;
 
-        // For R12, R3, R2, R1, R0
-        for (int i = 0; i < 5; i++) {
-            *(--task_stack_ptrs[target_task_id]) = 0xAAAAAAAA;
-        }
+    // For xPSR, PC and LR
+    *(--sp) = (1 << 24);
+    *(--sp) = (U32)(g_tcb_table[tid]->ptask);
+    *(--sp) = (U32)(osTaskExit);
 
-        // For R11, R10, R9, R8, R7, R6, R5, R4
-        for (int i = 0; i < 8; i++) {
-            *(--task_stack_ptrs[target_task_id]) = 0xAAAAAAAA;
-        }
+    // For R12, R3, R2, R1
+    for (int i = 0; i < 4; i++) {
+        *(--sp) = 0xAAAAAAAA;
     }
+    *(--sp) = (U32)(g_tcb_table[tid]->args);
 
-    // Update task states
-    if (current_task != TID_NULL && g_tasks[current_task].state == RUNNING) {
-        g_tasks[current_task].state = READY;
-        // Rst timer for preempted task if deadline-expired
-        if (g_tasks[current_task].time_left == 0) {
-            g_tasks[current_task].time_left = g_tasks[current_task].deadline_value;
-        }
+    // For R11, R10, R9, R8, R7, R6, R5, R4
+    for (int i = 0; i < 8; i++) {
+        *(--sp) = 0xAAAAAAAA;
     }
 
-    g_tasks[target_task_id].state = RUNNING;
-    g_tasks[target_task_id].is_fresh_task = TASK_EXISTING;
+    task_stack_ptrs[tid] = sp;
+}
 
-    // Rst target tasks deadline timer when starts running
-    if (g_tasks[target_task_id].time_left == 0) {
-        g_tasks[target_task_id].time_left = g_tasks[target_task_id].deadline_value;
+// a running task with time left is only preempted by a deadline below its threshold
+static int preempt_allowed(task_t current_task, task_t target) {
+    if (current_task == TID_NULL || g_task_state[current_task] != RUNNING ||
+        g_task_time_left[current_task] == 0) {
+        return 1;
+    }
+#if TT_ENABLED
+    // table releases are never held back
+    if (target == tt_current) {
+        return 1;
     }
+#endif
 
-    // Trigger hardware context switch
-    SCB->ICSR |= SCB_ICSR_PENDSVSET_Msk;
-    __asm volatile ("ISB");
+    U32 threshold = g_tcb_table[current_task]->preempt_threshold;
+    return threshold == 0 || g_task_deadline[target] < threshold;
 }
 
-// SVC Handler for system calls
-void SVC_Handler_Main(unsigned int *svc_args) {
-
-    uint8_t svc_number = ((char *)svc_args[6])[-2];
-
-    switch (svc_number) {
-    // Start kernel
-        case 0:
-            __set_PSP((uint32_t)task_stack_ptrs[target_task_id]);
-            start_first_task();
-            break;
+// Trigger context switch
+void trigger_context_switch(void) {
 
-         // yield
-        case 1:
-            // if switching to a new task then set up stack
-            if (target_task_id != TID_NULL && g_tasks[target_task_id].is_fresh_task == TASK_NEW) {
-                task_stack_ptrs[target_task_id] = (U32 *)g_tasks[target_task_id].stack_high;
 
-                *(--task_stack_ptrs[target_task_id]) = (1 << 24);
-                *(--task_stack_ptrs[target_task_id]) = (U32)(g_tasks[target_task_id].ptask);
-                *(--task_stack_ptrs[target_task_id]) = (U32)(osTaskExit);
+	task_t current_task = osGetTID_internal();
 
-                // For R12, R3, R2, R1, R0
-                for (int i = 0; i < 5; i++) {
-                    *(--task_stack_ptrs[target_task_id]) = 0xAAAAAAAA;
-                }
+    // holder of osSchedLock keeps the CPU, osSchedUnlock picks this up
+    if (current_task != TID_NULL && task_lock_depth[current_task] > 0 &&
+        g_task_state[current_task] == RUNNING) {
+        sched_pending = 1;
+        return;
+    }
 
-                // For R11, R10, R9, R8, R7, R6, R5, R4
-                for (int i = 0; i < 8; i++) {
-                    *(--task_stack_ptrs[target_task_id]) = 0xAAAAAAAA;
-                }
+    target_task_id = edf_scheduler();
 
-                g_tasks[target_task_id].is_fresh_task = TASK_EXISTING;
-            }
+    // a task throttled or exited from here cannot keep the CPU, park it in the null task
+    if (target_task_id == TID_NULL && current_task != TID_NULL &&
+        g_task_state[current_task] != RUNNING && g_task_state[current_task] != READY) {
+        SCB->ICSR |= SCB_ICSR_PENDSVSET_Msk;
+        __asm volatile ("ISB");
+        return;
+    }
 
-            // set target task to running and rst its time_left
-            if (target_task_id != TID_NULL) {
-                g_tasks[target_task_id].state = RUNNING;
-                if (g_tasks[target_task_id].time_left == 0) {
-                    g_tasks[target_task_id].time_left = g_tasks[target_task_id].deadline_value;
-                }
-            }
+    if (target_task_id == TID_NULL || target_task_id == current_task) {
+        return;
+    }
 
-            // trigger PendSV
-            SCB->ICSR |= SCB_ICSR_PENDSVSET_Msk;
-            __asm volatile ("ISB");
-            break;
+    if (!preempt_allowed(current_task, target_task_id)) {
+#if SCHED_STATS
+        g_sched_stats.preempt_skipped++;
+#endif
+        target_task_id = current_task;
+        return;
+    }
 
+    // sets up new task
+    if (g_tcb_table[target_task_id]->is_fresh_task == TASK_NEW) {
+        init_task_frame(target_task_id);
+    }
 
-        // Createtask
-        case 2:
-        {
-            TCB* task = (TCB*)svc_args[0];
-            svc_args[0] = osCreateTask_impl(task);
+    // Update task states
+    if (current_task != TID_NULL && g_task_state[current_task] == RUNNING) {
+        g_task_state[current_task] = READY;
+        // Rst timer for preempted task if deadline-expired
+        if (g_task_time_left[current_task] == 0) {
+            g_task_time_left[current_task] = g_task_deadline[current_task];
         }
-        break;
+    }
 
+    g_task_state[target_task_id] = RUNNING;
+    g_tcb_table[target_task_id]->is_fresh_task = TASK_EXISTING;
 
-        // CreateDeadlinetask
-        case 3:
-            {
-                int deadline = svc_args[0];
-                TCB* task = (TCB*)svc_args[1];
-                svc_args[0] = osCreateDeadlineTask_impl(deadline, task);
-            }
-            break;
-
-
-        // Setdeadline
-        case 4:
-            {
-                int deadline = svc_args[0];
-                task_t tid = svc_args[1];
-                // defaults to error
-                svc_args[0] = RTX_ERR;
-
-                if (deadline > 0 && tid < MAX_TASKS &&
-                    (g_tasks[tid].state == READY || g_tasks[tid].state == RUNNING)) {
-
-                	// blocks timer interrupts
-                    __disable_irq();
-                    g_tasks[tid].deadline_value = deadline;
-                    g_tasks[tid].time_left = deadline;
-
-                    // check if preemption is needed
-                    if (g_active_task_id != TID_NULL &&
-                        g_tasks[tid].deadline_value < g_tasks[g_active_task_id].deadline_value) {
-                        __enable_irq();
-                        trigger_context_switch();
-                        return;
-                    }
-                    __enable_irq();
-                    svc_args[0] = RTX_OK;
-                }
-            }
-            break;
+    // Rst target tasks deadline timer when starts running
+    if (g_task_time_left[target_task_id] == 0) {
+        g_task_time_left[target_task_id] = g_task_deadline[target_task_id];
+    }
 
+    // Trigger hardware context switch
+    SCB->ICSR |= SCB_ICSR_PENDSVSET_Msk;
+    __asm volatile ("ISB");
+}
 
-        // Task Info
-        case 5:
-            {
-                task_t tid = svc_args[0];
-                TCB* task_copy = (TCB*)svc_args[1];
-                svc_args[0] = osTaskInfo_impl(tid, task_copy);
-            }
-            break;
+// System calls, one handler per number, args are the stacked r0-r3
+static U32 sys_kernel_start(U32 a0, U32 a1, U32 a2, U32 a3) {
+    __set_PSP((uint32_t)task_stack_ptrs[target_task_id]);
+    start_first_task();
+    return RTX_OK;
+}
 
+// target_task_id was picked by the caller with the kernel critical section held
+static U32 sys_yield(U32 a0, U32 a1, U32 a2, U32 a3) {
+    // if switching to a new task then set up stack
+    if (target_task_id != TID_NULL && g_tcb_table[target_task_id]->is_fresh_task == TASK_NEW) {
+        init_task_frame(target_task_id);
+        g_tcb_table[target_task_id]->is_fresh_task = TASK_EXISTING;
+    }
 
+    // set target task to running and rst its time_left
+    if (target_task_id != TID_NULL) {
+        g_task_state[target_task_id] = RUNNING;
+        if (g_task_time_left[target_task_id] == 0) {
+            g_task_time_left[target_task_id] = g_task_deadline[target_task_id];
+        }
+    }
 
+    // trigger PendSV
+    SCB->ICSR |= SCB_ICSR_PENDSVSET_Msk;
+    __asm volatile ("ISB");
+    return RTX_OK;
+}
 
+static U32 sys_create_task(U32 task, U32 a1, U32 a2, U32 a3) {
+    return osCreateTask_impl((TCB*)task);
+}
 
-        // Meminit
-        case 7:
-            svc_args[0] = k_mem_init_impl();
-            break;
+static U32 sys_create_deadline_task(U32 deadline, U32 task, U32 a2, U32 a3) {
+    return osCreateDeadlineTask_impl((int)deadline, (TCB*)task);
+}
 
+static U32 sys_set_deadline(U32 deadline_arg, U32 tid, U32 a2, U32 a3) {
+    int deadline = (int)deadline_arg;
 
+    if (deadline <= 0 || tid >= MAX_TASKS ||
+        (g_task_state[tid] != READY && g_task_state[tid] != RUNNING)) {
+        return RTX_ERR;
+    }
 
-        // Memalloc
-        case 8:
-            {
-                size_t size = svc_args[0];
-                svc_args[0] = (unsigned int)k_mem_alloc_impl(size);
-            }
-            break;
+    // blocks kernel interrupts
+    U32 crit = k_crit_enter();
+#if BUDGET_ENFORCE
+    // a demoted task gets its new deadline back when the window ends
+    if (task_budget_flags[tid] & BUDGET_FLAG_DEMOTED) {
+        task_saved_deadline[tid] = deadline;
+    } else {
+        g_task_deadline[tid] = deadline;
+    }
+#else
+    g_task_deadline[tid] = deadline;
+#endif
+    g_task_time_left[tid] = deadline;
+    if (g_tcb_table[tid]->is_periodic) {
+        g_tcb_table[tid]->period = deadline;
+    }
 
-        // Memdealloc
-        case 9:
-            {
-                void* ptr = (void*)svc_args[0];
-                svc_args[0] = k_mem_dealloc_impl(ptr);
-            }
-            break;
+    // check if preemption is needed
+    int preempt = g_active_task_id != TID_NULL &&
+                  g_task_deadline[tid] < g_task_deadline[g_active_task_id];
+    k_crit_exit(crit);
 
+    if (preempt) {
+        trigger_context_switch();
+    }
+    return RTX_OK;
+}
 
-         // mem cnt extfrag
-        case 10:
-            {
-                size_t size = svc_args[0];
-                svc_args[0] = k_mem_count_extfrag_impl(size);
-            }
-            break;
+static U32 sys_task_info(U32 tid, U32 task_copy, U32 a2, U32 a3) {
+    return osTaskInfo_impl(tid, (TCB*)task_copy);
+}
 
+static U32 sys_create_server_task(U32 server, U32 task, U32 a2, U32 a3) {
+    return osCreateServerTask_impl((k_cbs_t*)server, (TCB*)task);
+}
 
+static U32 sys_mem_init(U32 a0, U32 a1, U32 a2, U32 a3) {
+    return k_mem_init_impl();
+}
 
+static U32 sys_mem_alloc(U32 size, U32 hint, U32 a2, U32 a3) {
+    return (U32)k_mem_alloc_hint_impl(size, (U8)hint);
+}
 
+static U32 sys_mem_dealloc(U32 ptr, U32 a1, U32 a2, U32 a3) {
+    return k_mem_dealloc_impl((void*)ptr);
+}
 
+static U32 sys_mem_extfrag(U32 size, U32 a1, U32 a2, U32 a3) {
+    return k_mem_count_extfrag_impl(size);
+}
 
+static U32 sys_get_tid(U32 a0, U32 a1, U32 a2, U32 a3) {
+    return g_active_task_id;
+}
 
+static U32 sys_task_exit(U32 a0, U32 a1, U32 a2, U32 a3) {
+    if (g_active_task_id == TID_NULL) {
+        return RTX_ERR;
+    }
 
+    // Free the stack using the stored base pointer, back to the slab or the heap
+    if (!g_tcb_table[g_active_task_id]->is_static) {
+        free_task_stack(g_tcb_table[g_active_task_id]->stack_base);
+    }
 
+    g_task_state[g_active_task_id] = DORMANT;
+    task_stack_ptrs[g_active_task_id] = NULL;
+    task_stack_limits[g_active_task_id] = NULL;
 
-         //  getTID
-        case 15:
-            svc_args[0] = g_active_task_id;
-            break;
+    // give the TCB and TID back, static TCBs stay where they are
+    if (!g_tcb_table[g_active_task_id]->is_static) {
+        k_pool_free(&tcb_pool, g_tcb_table[g_active_task_id]);
+    }
+    g_tcb_table[g_active_task_id] = NULL;
+    tid_free_stack[tid_free_top++] = g_active_task_id;
+    task_list_remove(g_active_task_id);
+
+    // a lock dies with the task holding it
+    task_lock_depth[g_active_task_id] = 0;
+    sched_pending = 0;
+#if TT_ENABLED
+    if (tt_current == g_active_task_id) {
+        tt_current = TID_NULL;
+    }
+#endif
 
-        // Taskexit
-        case 17:
-            if (g_active_task_id != TID_NULL) {
-                // Free the stack using the stored base pointer
-                if (k_mem_dealloc_impl(g_tasks[g_active_task_id].stack_base) != RTX_OK) {
-                    // Handle error but continue cleanup
-                }
+    trigger_context_switch();
+    return RTX_OK;
+}
 
-                g_tasks[g_active_task_id].state = DORMANT;
-                g_tasks[g_active_task_id].ptask = NULL;
-                g_tasks[g_active_task_id].stack_high = 0;
-                g_tasks[g_active_task_id].stack_size = 0;
-                g_tasks[g_active_task_id].stack_base = NULL;
-                g_tasks[g_active_task_id].stack_ptr = NULL;
-                g_tasks[g_active_task_id].is_fresh_task = TASK_NEW;
-                task_stack_ptrs[g_active_task_id] = NULL;
+static U32 sys_kernel_init(U32 a0, U32 a1, U32 a2, U32 a3) {
+    osKernelInit_impl();
+    return RTX_OK;
+}
 
-                g_num_tasks--;
-                trigger_context_switch();
-            }
-            break;
+static const syscall_fn syscall_table[SYSCALL_COUNT] = {
+    [SYS_KERNEL_START] = sys_kernel_start,
+    [SYS_YIELD] = sys_yield,
+    [SYS_CREATE_TASK] = sys_create_task,
+    [SYS_CREATE_DEADLINE_TASK] = sys_create_deadline_task,
+    [SYS_SET_DEADLINE] = sys_set_deadline,
+    [SYS_TASK_INFO] = sys_task_info,
+    [SYS_CREATE_SERVER_TASK] = sys_create_server_task,
+    [SYS_MEM_INIT] = sys_mem_init,
+    [SYS_MEM_ALLOC] = sys_mem_alloc,
+    [SYS_MEM_DEALLOC] = sys_mem_dealloc,
+    [SYS_MEM_EXTFRAG] = sys_mem_extfrag,
+    [SYS_GET_TID] = sys_get_tid,
+    [SYS_TASK_EXIT] = sys_task_exit,
+    [SYS_KERNEL_INIT] = sys_kernel_init,
+};
+
+#if SCHED_STATS
+U32 g_syscall_cycles[SYSCALL_COUNT];
+#endif
 
-        // Kernelinit
-        case 18:
-            osKernelInit_impl();
-            break;
+// SVC Handler for system calls, svc_args is the exception frame r0-r3, r12, lr, pc, xpsr
+void SVC_Handler_Main(unsigned int *svc_args) {
+    U32 nr = svc_args[4];
 
-        default:
-            break;
+    if (nr < SYSCALL_COUNT) {
+        svc_args[0] = syscall_table[nr](svc_args[0], svc_args[1], svc_args[2], svc_args[3]);
     }
 }
 
 // Functions for lab
 
-// osgetTID function which just calls svc case
+// osgetTID reads the shared kernel page, no svc needed
 task_t osGetTID(void) {
-    task_t result;
-    __asm volatile (
-        "svc #15\n\t"
-        "mov %0, r0"
-        : "=r" (result)
-        :
-        : "r0"
-    );
-    return result;
+    return osGetTIDFast();
 }
 
  // Internal copy of getostid so can be backed by svc call
@@ -489,24 +820,31 @@ void osYield(void) {
 	task_t current_task = osGetTID_internal();
 
     if (current_task != TID_NULL) {
-        __disable_irq();
+        U32 crit = k_crit_enter();
+
+        // the lock holder keeps the CPU, its osSchedUnlock does the switch
+        if (task_lock_depth[current_task] > 0) {
+            sched_pending = 1;
+            k_crit_exit(crit);
+            return;
+        }
 
         // Set current task back to READY
-        g_tasks[current_task].state = READY;
+        g_task_state[current_task] = READY;
 
         // Only reset timer for nonperiodic tasks
-        if (!g_tasks[current_task].is_periodic) {
-            g_tasks[current_task].time_left = g_tasks[current_task].deadline_value;
+        if (!g_tcb_table[current_task]->is_periodic) {
+            g_task_time_left[current_task] = g_task_deadline[current_task];
         }
 
 
         // find next task to run
         target_task_id = edf_scheduler();
 
-        __enable_irq();
+        k_crit_exit(crit);
 
         if (target_task_id != TID_NULL) {
-            __asm("SVC #1");
+            k_syscall0(SYS_YIELD);
         }
     }
 }
@@ -518,20 +856,20 @@ void osYield(void) {
 void osSleep(int timeInMs) {
 	task_t current_task = osGetTID_internal();
     if (current_task != TID_NULL && timeInMs > 0) {
-        __disable_irq();
+        U32 crit = k_crit_enter();
 
         // Sets task to sleeping
-        g_tasks[current_task].state = SLEEPING;
-        g_tasks[current_task].time_left = timeInMs;
+        g_task_state[current_task] = SLEEPING;
+        g_task_time_left[current_task] = timeInMs;
         target_task_id = edf_scheduler();
 
-        __enable_irq();
+        k_crit_exit(crit);
 
         if (target_task_id != TID_NULL) {
         	// yield SVC call
-            __asm("SVC #1");
+            k_syscall0(SYS_YIELD);
         } else {
-            while (g_tasks[current_task].state == SLEEPING) {
+            while (g_task_state[current_task] == SLEEPING) {
                 __asm("wfi");
             }
         }
@@ -541,14 +879,166 @@ void osSleep(int timeInMs) {
 
 
 
+#if BUDGET_ENFORCE
+// called from SysTick, overruns are caught within one tick
+int budget_tick(void) {
+    task_t tid = g_active_task_id;
+    U32 now = DWT_CYCCNT;
+
+    if (tid == TID_NULL) {
+        budget_stamp = now;
+        return 0;
+    }
+    g_task_cycles[tid] += now - budget_stamp;
+    budget_stamp = now;
+
+    if (g_task_budget[tid] == 0 || g_task_cycles[tid] <= g_task_budget[tid] ||
+        (task_budget_flags[tid] & BUDGET_FLAG_HIT)) {
+        return 0;
+    }
+
+    task_budget_flags[tid] |= BUDGET_FLAG_HIT;
+    g_task_budget_overruns[tid]++;
+    osBudgetOverrunHook(tid);
+
+    if (!(task_budget_flags[tid] & BUDGET_FLAG_DEMOTE)) {
+        // sleep out the rest of the window, the tick loop wakes it when time_left runs out
+        g_task_state[tid] = SLEEPING;
+        g_task_time_left[tid] = task_window_left[tid] > 0 ? task_window_left[tid] : 1;
+    } else {
+        task_saved_deadline[tid] = g_task_deadline[tid];
+        g_task_deadline[tid] = BUDGET_BACKGROUND_DEADLINE;
+        task_budget_flags[tid] |= BUDGET_FLAG_DEMOTED;
+    }
+    return 1;
+}
+
+
+
+// called from SysTick for every live task after its time_left is updated. The
+// window is one relative deadline long and kept apart from time_left, which a
+// demoted task reloads from BUDGET_BACKGROUND_DEADLINE. Returns 1 when a
+// demoted task gets its deadline back.
+int budget_window_tick(task_t tid) {
+    if (task_window_left[tid] > 1) {
+        task_window_left[tid]--;
+        return 0;
+    }
+
+    int reschedule = 0;
+    g_task_cycles[tid] = 0;
+    if (task_budget_flags[tid] & BUDGET_FLAG_DEMOTED) {
+        g_task_deadline[tid] = task_saved_deadline[tid];
+        // a slice loaded while demoted would run for ages
+        if (g_task_state[tid] != SLEEPING && g_task_time_left[tid] > g_task_deadline[tid]) {
+            g_task_time_left[tid] = g_task_deadline[tid];
+        }
+        reschedule = 1;
+    }
+    task_budget_flags[tid] &= BUDGET_FLAG_DEMOTE;
+    task_window_left[tid] = g_task_deadline[tid];
+    return reschedule;
+}
+
+
+
+// budget_us of CPU per deadline window, 0 removes the budget
+int osSetBudget(task_t tid, U32 budget_us, U8 policy) {
+    if (tid == TID_NULL || tid >= MAX_TASKS || g_tcb_table[tid] == NULL ||
+        (policy != BUDGET_THROTTLE && policy != BUDGET_DEMOTE)) {
+        return RTX_ERR;
+    }
+
+    U32 crit = k_crit_enter();
+    g_task_budget[tid] = budget_us * (SystemCoreClock / 1000000);
+    task_budget_flags[tid] = (task_budget_flags[tid] & ~BUDGET_FLAG_DEMOTE) |
+                             (policy == BUDGET_DEMOTE ? BUDGET_FLAG_DEMOTE : 0);
+    k_crit_exit(crit);
+
+    return RTX_OK;
+}
+
+
+
+// called from SysTick when a task overruns its budget, override to log or recover
+__attribute__((weak)) void osBudgetOverrunHook(task_t tid) {
+}
+#endif
+
+
+
+#if TT_ENABLED
+// called from SysTick, releases the job the table has for this tick in O(1)
+int tt_tick(void) {
+    k_tcb_t* tcb = g_tt_table[tt_slot];
+    if (++tt_slot >= g_tt_table_len) {
+        tt_slot = 0;
+    }
+    if (tcb == NULL) {
+        return 0;
+    }
+
+    task_t tid = tcb->tid;
+
+    // table task only waits for its slot with SLEEPING and no timer, the
+    // current job can look the same while it is blocked in a wait
+    if (tid == tt_current || g_task_state[tid] != SLEEPING || g_task_time_left[tid] != 0) {
+        g_tt_overruns++;
+        return 0;
+    }
+
+    // previous job still running, it finishes as an ordinary EDF task
+    if (tt_current != TID_NULL) {
+        g_tt_overruns++;
+    }
+
+    g_task_state[tid] = READY;
+    tt_current = tid;
+    return 1;
+}
+
+
+
+// ends the current job, the task runs again on its next table slot
+void osTTYield(void) {
+    task_t current_task = osGetTID_internal();
+    if (current_task == TID_NULL) {
+        return;
+    }
+
+    U32 crit = k_crit_enter();
+
+    // SLEEPING with no timer, only tt_tick wakes it
+    g_task_state[current_task] = SLEEPING;
+    g_task_time_left[current_task] = 0;
+    if (tt_current == current_task) {
+        tt_current = TID_NULL;
+    }
+    target_task_id = edf_scheduler();
+
+    k_crit_exit(crit);
+
+    if (target_task_id != TID_NULL) {
+        k_syscall0(SYS_YIELD);
+    } else {
+        while (g_task_state[current_task] == SLEEPING) {
+            __asm("wfi");
+        }
+    }
+}
+#endif
+
+
+
+
 // OsPeriodyield just calls osSleep with tasks deadline value
 void osPeriodYield(void) {
 	task_t current_tid = osGetTID_internal();
 
 
     if (current_tid != TID_NULL) {
-        if (g_tasks[current_tid].is_periodic) {
-            int remaining_time = g_tasks[current_tid].time_left;
+        if (g_tcb_table[current_tid]->is_periodic) {
+            int remaining_time = g_task_time_left[current_tid];
             if (remaining_time > 0) {
             	// sleep until period ends
             	osSleep(remaining_time);
@@ -556,22 +1046,90 @@ void osPeriodYield(void) {
 
             } else {
             	// reset for next period
-                g_tasks[current_tid].time_left = g_tasks[current_tid].deadline_value;
+                g_task_time_left[current_tid] = g_task_deadline[current_tid];
             }
         } else {
         	// for nonperiodic task just sleep till deadline
-            osSleep(g_tasks[current_tid].deadline_value);
+            osSleep(g_task_deadline[current_tid]);
         }
     }
 }
 
 
 
+// start latency of the job released at release, stats only
+static void record_release(k_tcb_t* tcb, U32 release) {
+    period_stats_t* stats = &tcb->period_stats;
+    U32 jitter = k_time_us_since_tick(release);
+
+    stats->releases++;
+    stats->jitter_last_us = jitter;
+    if (jitter > stats->jitter_max_us) {
+        stats->jitter_max_us = jitter;
+    }
+}
+
+
+
+// blocks until the next absolute release, next_period_start += period so late
+// jobs and deadline resets never push the later releases back
+// returns 0 on time, otherwise how many releases had already passed
+int osWaitUntilNextPeriod(void) {
+    task_t current_task = osGetTID_internal();
+    if (current_task == TID_NULL) {
+        return RTX_ERR;
+    }
+
+    k_tcb_t* tcb = g_tcb_table[current_task];
+    if (tcb->period == 0) {
+        return RTX_ERR;
+    }
+
+    U32 crit = k_crit_enter();
+    U32 release = tcb->next_period_start + tcb->period;
+    int late = (int)(g_system_time - release);
+
+    if (late >= 0) {
+        // release tick already here, a whole tick late counts as an overrun
+        // and the missed releases are skipped, keeping the phase
+        U32 missed = (U32)late / tcb->period;
+        release += missed * tcb->period;
+        tcb->next_period_start = release;
+        if (late > 0) {
+            tcb->period_stats.overruns++;
+        }
+        k_crit_exit(crit);
+
+        record_release(tcb, release);
+        return late > 0 ? (int)missed + 1 : 0;
+    }
+
+    // sleep exactly until the tick that reaches release, the tick loop
+    // reloads time_left with the deadline on wake
+    tcb->next_period_start = release;
+    g_task_state[current_task] = SLEEPING;
+    g_task_time_left[current_task] = (U32)(-late);
+    target_task_id = edf_scheduler();
+
+    k_crit_exit(crit);
+
+    if (target_task_id != TID_NULL) {
+        k_syscall0(SYS_YIELD);
+    } else {
+        while (g_task_state[current_task] == SLEEPING) {
+            __asm("wfi");
+        }
+    }
+
+    record_release(tcb, release);
+    return 0;
+}
+
+
+
 // ossetdeadline which just calls svc call
 int osSetDeadline(int deadline, task_t TID) {
-    int result;
-    __asm("SVC #4" : "=r" (result) : "r" (deadline), "r" (TID));
-    return result;
+    return (int)k_syscall2(SYS_SET_DEADLINE, (U32)deadline, TID);
 }
 
 
@@ -581,7 +1139,8 @@ int osSetDeadline(int deadline, task_t TID) {
 
 
 // implementation of oscreatetask
-int osCreateTask_impl(TCB *task) {
+// allocates and registers a task, the caller decides on preemption
+static int create_task(TCB *task) {
 	// cant make tasks until kernel is ready
     if (!g_kernel_initialized) {
         return RTX_ERR;
@@ -595,74 +1154,99 @@ int osCreateTask_impl(TCB *task) {
         return RTX_ERR;
     }
 
-    // find empty task slot to use
-    task_t new_tid = TID_NULL;
-    for (int i = 1; i < MAX_TASKS; i++) {
-        if (g_tasks[i].state == DORMANT) {
-            new_tid = i;
-            break;
-        }
+    // grab a free TID and a TCB for it
+    if (tid_free_top == 0) {
+        return RTX_ERR;
     }
 
-    if (new_tid == TID_NULL || g_num_tasks >= (MAX_TASKS - 1)) {
+    k_tcb_t* tcb = (k_tcb_t*)k_pool_alloc(&tcb_pool);
+    if (tcb == NULL) {
         return RTX_ERR;
     }
 
-    // alloc mem for task stack
-    void* allocated_stack = k_mem_alloc_impl(task->stack_size);
+    U32 stack_limit;
+    void* allocated_stack = alloc_task_stack(task->stack_size, &stack_limit);
     if (allocated_stack == NULL) {
+        k_pool_free(&tcb_pool, tcb);
         return RTX_ERR;
     }
 
+    task_t new_tid = tid_free_stack[--tid_free_top];
+    g_tcb_table[new_tid] = tcb;
+
+    task_stack_limits[new_tid] = (U32*)stack_limit;
+
+    paint_task_stack((void*)stack_limit, task->stack_size);
+
     // initialize all TCB fields
-    g_tasks[new_tid].ptask = task->ptask;
-    g_tasks[new_tid].stack_size = task->stack_size;
-    g_tasks[new_tid].stack_high = (U32)allocated_stack + task->stack_size;
-    g_tasks[new_tid].stack_base = allocated_stack;
-    g_tasks[new_tid].tid = new_tid;
-    g_tasks[new_tid].state = READY;
-    g_tasks[new_tid].stack_ptr = NULL;
-    g_tasks[new_tid].is_fresh_task = TASK_NEW;
-    g_tasks[new_tid].deadline_value = 5;
-    g_tasks[new_tid].time_left = 5;
-    g_tasks[new_tid].sleep_time = 0;
-    g_tasks[new_tid].period = 0;
-    g_tasks[new_tid].next_period_start = 0;
-    g_tasks[new_tid].is_periodic = 0;
-
-    // update mem block to new task
-    mem_block_t* block = (mem_block_t*)((U8*)allocated_stack - sizeof(mem_block_t));
-    block->owner_tid = new_tid;
+    g_tcb_table[new_tid]->ptask = task->ptask;
+    g_tcb_table[new_tid]->args = task->args;
+    g_tcb_table[new_tid]->stack_size = task->stack_size;
+    g_tcb_table[new_tid]->stack_high = stack_limit + task->stack_size;
+    g_tcb_table[new_tid]->stack_base = allocated_stack;
+    g_tcb_table[new_tid]->tid = new_tid;
+    g_task_state[new_tid] = READY;
+    g_tcb_table[new_tid]->is_fresh_task = TASK_NEW;
+    g_task_deadline[new_tid] = 5;
+    g_task_time_left[new_tid] = 5;
+    g_tcb_table[new_tid]->sleep_time = 0;
+    g_tcb_table[new_tid]->period = 0;
+    g_tcb_table[new_tid]->next_period_start = g_system_time;
+    g_tcb_table[new_tid]->period_stats = (period_stats_t){0};
+    g_tcb_table[new_tid]->is_periodic = 0;
+    g_tcb_table[new_tid]->is_static = 0;
+    g_tcb_table[new_tid]->server = NULL;
+    g_tcb_table[new_tid]->preempt_threshold = 0;
+    task_notify_bits[new_tid] = 0;
+    task_notify_mask[new_tid] = 0;
+    task_lock_depth[new_tid] = 0;
+#if BUDGET_ENFORCE
+    g_task_budget[new_tid] = 0;
+    g_task_cycles[new_tid] = 0;
+    g_task_budget_overruns[new_tid] = 0;
+    task_budget_flags[new_tid] = 0;
+    task_window_left[new_tid] = 0;
+#endif
+
+    // update mem block to new task, slab stacks have no heap header
+    if (!stack_from_slab(allocated_stack)) {
+        k_mem_set_owner(allocated_stack, new_tid);
+    }
 
     // update input task with assigned TID and stack info
     task->tid = new_tid;
-    task->stack_high = g_tasks[new_tid].stack_high;
+    task->stack_high = g_tcb_table[new_tid]->stack_high;
+
+    task_list_add(new_tid);
+
+    return RTX_OK;
+}
 
-    g_num_tasks++;
 
-    // check preemption if kernel is running
+
+// new task starts READY and may preempt the caller
+static void check_create_preemption(task_t new_tid) {
     if (g_kernel_running && g_active_task_id != TID_NULL) {
-        if (g_tasks[new_tid].deadline_value < g_tasks[g_active_task_id].deadline_value) {
+        if (g_task_deadline[new_tid] < g_task_deadline[g_active_task_id]) {
             trigger_context_switch();
         }
     }
+}
 
-    return RTX_OK;
+
+
+int osCreateTask_impl(TCB *task) {
+    int result = create_task(task);
+    if (result == RTX_OK) {
+        check_create_preemption(task->tid);
+    }
+    return result;
 }
 
 
 // oscreatetask which just calls svc call
 int osCreateTask(TCB *task) {
-    int result;
-    __asm volatile (
-        "mov r0, %1\n\t"
-        "svc #2\n\t"
-        "mov %0, r0"
-        : "=r" (result)
-        : "r" (task)
-        : "r0"
-    );
-    return result;
+    return (int)k_syscall1(SYS_CREATE_TASK, (U32)task);
 }
 
 
@@ -681,44 +1265,258 @@ int osCreateDeadlineTask_impl(int deadline, TCB* task) {
         return RTX_ERR;
     }
 
-    // create task using oscreate task logic
-    int result = osCreateTask_impl(task);
+    // create task using oscreate task logic, preemption is checked once the deadline is set
+    int result = create_task(task);
     if (result != RTX_OK) {
         return result;
     }
 
     // update deadline and mark as periodic
     task_t new_tid = task->tid;
-    g_tasks[new_tid].deadline_value = deadline;
-    g_tasks[new_tid].time_left = deadline;
-    g_tasks[new_tid].next_period_start = 0;
+    g_task_deadline[new_tid] = deadline;
+    g_task_time_left[new_tid] = deadline;
+    g_tcb_table[new_tid]->period = deadline;
     // marks as periodic
-    g_tasks[new_tid].is_periodic = 1;
+    g_tcb_table[new_tid]->is_periodic = 1;
 
-    // Check for preemption
-    if (g_kernel_running && g_active_task_id != TID_NULL) {
-        if (deadline < g_tasks[g_active_task_id].deadline_value) {
-            trigger_context_switch();
+    check_create_preemption(new_tid);
+
+    return RTX_OK;
+}
+
+
+
+// threshold is in deadline units, 0 lets any ready task preempt tid
+int osSetPreemptThreshold(task_t tid, U32 threshold) {
+    if (tid == TID_NULL || tid >= MAX_TASKS || g_tcb_table[tid] == NULL) {
+        return RTX_ERR;
+    }
+
+    U32 crit = k_crit_enter();
+    g_tcb_table[tid]->preempt_threshold = threshold;
+    k_crit_exit(crit);
+
+    return RTX_OK;
+}
+
+
+
+// readies a blocked or sleeping task inside a critical section,
+// returns 1 if it should preempt the running task
+static int ready_task(task_t tid) {
+    g_task_state[tid] = READY;
+    g_task_time_left[tid] = g_task_deadline[tid];
+    return g_active_task_id == TID_NULL ||
+           g_task_deadline[tid] < g_task_deadline[g_active_task_id];
+}
+
+int k_unblock(task_t tid) {
+    if (g_task_state[tid] == SLEEPING && g_task_time_left[tid] == 0) {
+        return ready_task(tid);
+    }
+    return 0;
+}
+
+void k_block_current(U32 crit) {
+    k_sleep_current(crit, 0);
+}
+
+// time_left 0 is the no timer case k_unblock looks for
+void k_sleep_current(U32 crit, U32 ticks) {
+    task_t current_task = g_active_task_id;
+
+    g_task_state[current_task] = SLEEPING;
+    g_task_time_left[current_task] = ticks;
+    target_task_id = edf_scheduler();
+
+    k_crit_exit(crit);
+
+    if (target_task_id != TID_NULL) {
+        k_syscall0(SYS_YIELD);
+    } else {
+        while (g_task_state[current_task] == SLEEPING) {
+            __asm("wfi");
+        }
+    }
+}
+
+static int valid_task(task_t tid) {
+    return tid != TID_NULL && tid < MAX_TASKS && g_tcb_table[tid] != NULL;
+}
+
+
+
+int osGetPeriodStats(task_t tid, period_stats_t* stats) {
+    if (stats == NULL || !valid_task(tid)) {
+        return RTX_ERR;
+    }
+
+    U32 crit = k_crit_enter();
+    *stats = g_tcb_table[tid]->period_stats;
+    k_crit_exit(crit);
+
+    return RTX_OK;
+}
+
+
+
+// ends an osSleep early, blocked waits are woken by their own primitive
+int osTaskWakeFromISR(task_t tid, int* switch_needed) {
+    if (!valid_task(tid)) {
+        return RTX_ERR;
+    }
+
+    int result = RTX_ERR;
+    U32 crit = k_crit_enter();
+    if (g_task_state[tid] == SLEEPING && g_task_time_left[tid] > 0) {
+        if (ready_task(tid) && switch_needed != NULL) {
+            *switch_needed = 1;
         }
+        result = RTX_OK;
+    }
+    k_crit_exit(crit);
+
+    return result;
+}
+
+
+
+// sets bits and wakes tid if it is waiting on any of them, crit held
+static int notify_locked(task_t tid, U32 bits) {
+    task_notify_bits[tid] |= bits;
+    if (task_notify_mask[tid] & task_notify_bits[tid]) {
+        task_notify_mask[tid] = 0;
+        return ready_task(tid);
+    }
+    return 0;
+}
+
+int osNotifyFromISR(task_t tid, U32 bits, int* switch_needed) {
+    if (!valid_task(tid)) {
+        return RTX_ERR;
+    }
+
+    U32 crit = k_crit_enter();
+    if (notify_locked(tid, bits) && switch_needed != NULL) {
+        *switch_needed = 1;
+    }
+    k_crit_exit(crit);
+
+    return RTX_OK;
+}
+
+int osNotify(task_t tid, U32 bits) {
+    if (!valid_task(tid)) {
+        return RTX_ERR;
     }
 
+    U32 crit = k_crit_enter();
+    int preempt = notify_locked(tid, bits);
+    k_crit_exit(crit);
+
+    if (preempt) {
+        osYield();
+    }
+    return RTX_OK;
+}
+
+
+
+// blocks until any bit in mask is set, returns and clears those bits
+U32 osNotifyWait(U32 mask) {
+    task_t current_task = osGetTID_internal();
+    if (current_task == TID_NULL || mask == 0) {
+        return 0;
+    }
+
+    U32 crit = k_crit_enter();
+
+    if ((task_notify_bits[current_task] & mask) == 0) {
+        // SLEEPING with no timer, only notify_locked wakes it
+        task_notify_mask[current_task] = mask;
+        g_task_state[current_task] = SLEEPING;
+        g_task_time_left[current_task] = 0;
+        target_task_id = edf_scheduler();
+
+        k_crit_exit(crit);
+
+        if (target_task_id != TID_NULL) {
+            k_syscall0(SYS_YIELD);
+        } else {
+            while (g_task_state[current_task] == SLEEPING) {
+                __asm("wfi");
+            }
+        }
+
+        crit = k_crit_enter();
+    }
+
+    U32 got = task_notify_bits[current_task] & mask;
+    task_notify_bits[current_task] &= ~got;
+    k_crit_exit(crit);
+
+    return got;
+}
+
+
+
+// last call of an ISR, one reschedule for everything the ISR readied
+void osEndISR(int switch_needed) {
+    if (switch_needed && g_kernel_running) {
+        U32 crit = k_crit_enter();
+        trigger_context_switch();
+        k_crit_exit(crit);
+    }
+}
+
+
+
+// only the running task changes its own depth, ISRs just read it
+void osSchedLock(void) {
+    task_lock_depth[osGetTID_internal()]++;
+}
+
+
+
+int osSchedUnlock(void) {
+    task_t current_task = osGetTID_internal();
+    if (task_lock_depth[current_task] == 0) {
+        return RTX_ERR;
+    }
+
+    if (--task_lock_depth[current_task] == 0 && sched_pending) {
+        // run the reschedule that was held back, short critical section only here
+        U32 crit = k_crit_enter();
+        sched_pending = 0;
+        trigger_context_switch();
+        k_crit_exit(crit);
+    }
+
+    return RTX_OK;
+}
+
+
+
+// osCreateServerTask implementation, budget and period are already in server
+int osCreateServerTask_impl(k_cbs_t* server, TCB* task) {
+    if (server == NULL || server->budget == 0 || server->budget > server->period) {
+        return RTX_ERR;
+    }
+
+    int result = create_task(task);
+    if (result != RTX_OK) {
+        return result;
+    }
+
+    k_cbs_attach(server, task->tid);
+    check_create_preemption(task->tid);
+
     return RTX_OK;
 }
 
 // oscreatedeadlinetask which just calls svc call
 int osCreateDeadlineTask(int deadline, TCB* task) {
-    int result;
-    // Use the same approach that worked for osTaskInfo
-    __asm volatile (
-        "mov r0, %1\n\t"
-        "mov r1, %2\n\t"
-        "svc #3\n\t"
-        "mov %0, r0"
-        : "=r" (result)
-        : "r" (deadline), "r" (task)
-        : "r0", "r1"
-    );
-    return result;
+    return (int)k_syscall2(SYS_CREATE_DEADLINE_TASK, (U32)deadline, (U32)task);
 }
 
 
@@ -743,24 +1541,17 @@ int osKernelStart(void) {
 
     // set up first task
     g_active_task_id = target_task_id;
-    task_stack_ptrs[target_task_id] = (U32 *)g_tasks[target_task_id].stack_high;
-    // set up stack frame
-    *(--task_stack_ptrs[target_task_id]) = (1 << 24);
-    *(--task_stack_ptrs[target_task_id]) = (U32)(g_tasks[target_task_id].ptask);
-    *(--task_stack_ptrs[target_task_id]) = (U32)(osTaskExit);
-    // fill in bogus register values
-    for (int j = 0; j < 13; j++) {
-        *(--task_stack_ptrs[target_task_id]) = 0xAAAAAAAA;
-    }
+    init_task_frame(target_task_id);
 
-    g_tasks[target_task_id].state = RUNNING;
-    g_tasks[target_task_id].is_fresh_task = TASK_EXISTING;
-    g_tasks[target_task_id].time_left = g_tasks[target_task_id].deadline_value;
+    g_task_state[target_task_id] = RUNNING;
+    g_tcb_table[target_task_id]->is_fresh_task = TASK_EXISTING;
+    g_task_time_left[target_task_id] = g_task_deadline[target_task_id];
 
     // make sure all tasks start with fresh deadlines
-    for (int i = 1; i < MAX_TASKS; i++) {
-        if (g_tasks[i].state == READY) {
-            g_tasks[i].time_left = g_tasks[i].deadline_value;
+    for (int k = 0; k < g_num_tasks; k++) {
+        task_t i = g_task_list[k];
+        if (g_task_state[i] == READY) {
+            g_task_time_left[i] = g_task_deadline[i];
         }
     }
 
@@ -768,11 +1559,10 @@ int osKernelStart(void) {
 
     // timer resets
     g_system_time = 0;
-    SysTick->VAL = 0;
     extern volatile uint32_t uwTick;
     uwTick = 0;
 
-    __asm("SVC #0");
+    k_syscall0(SYS_KERNEL_START);
     return RTX_ERR;
 }
 
@@ -784,32 +1574,55 @@ int osTaskInfo_impl(task_t tid, TCB* task_copy) {
         return RTX_ERR;
     }
 
-    // copies entire TCB
-    *task_copy = g_tasks[tid];
+    // free TID, report it as an empty dormant slot
+    if (g_tcb_table[tid] == NULL) {
+        U8* bytes = (U8*)task_copy;
+        for (U32 i = 0; i < sizeof(TCB); i++) {
+            bytes[i] = 0;
+        }
+        task_copy->tid = tid;
+        task_copy->state = DORMANT;
+        task_copy->deadline_value = g_task_deadline[tid];
+        return RTX_OK;
+    }
+
+    // build the public copy from the kernel side state
+    task_copy->ptask = g_tcb_table[tid]->ptask;
+    task_copy->args = g_tcb_table[tid]->args;
+    task_copy->stack_high = g_tcb_table[tid]->stack_high;
+    task_copy->tid = g_tcb_table[tid]->tid;
+    task_copy->state = g_task_state[tid];
+    task_copy->stack_size = g_tcb_table[tid]->stack_size;
+    task_copy->stack_ptr = task_stack_ptrs[tid];
+    task_copy->is_fresh_task = g_tcb_table[tid]->is_fresh_task;
+    task_copy->time_left = g_task_time_left[tid];
+    task_copy->deadline_value = g_task_deadline[tid];
+    task_copy->sleep_time = g_tcb_table[tid]->sleep_time;
+    task_copy->period = g_tcb_table[tid]->period;
+    task_copy->next_period_start = g_tcb_table[tid]->next_period_start;
+    task_copy->is_periodic = g_tcb_table[tid]->is_periodic;
+    task_copy->stack_base = g_tcb_table[tid]->stack_base;
+    task_copy->stack_hwm = task_stack_high_water(tid);
     return RTX_OK;
 }
 
 // ostaskinfo function which just calls svc call
 int osTaskInfo(task_t tid, TCB* task_copy) {
-    int result;
-
-    __asm volatile (
-        "mov r0, %1\n\t"
-        "mov r1, %2\n\t"
-        "svc #5\n\t"
-        "mov %0, r0"
-        : "=r" (result)
-        : "r" (tid), "r" (task_copy)
-        : "r0", "r1"
-    );
-    return result;
+    return (int)k_syscall2(SYS_TASK_INFO, tid, (U32)task_copy);
 }
 
 
 
 
-// ostaskexit which just calls svc call
+// ostaskexit which just calls svc call, only returns outside a task
 int osTaskExit(void) {
-    __asm("SVC #17");
-    return RTX_OK;
+    if ((int)k_syscall0(SYS_TASK_EXIT) != RTX_OK) {
+        return RTX_ERR;
+    }
+
+    // nothing else was ready so there was no switch, wait on the dead stack
+    // until a tick readies a task; PendSV never comes back here
+    while (1) {
+        __asm("wfi");
+    }
 }
@@ -23,6 +23,11 @@
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
 #include "k_task.h"
+#include "k_prof.h"
+#include "k_mpu.h"
+#include "k_cbs.h"
+#include "k_time.h"
+#include "k_timer.h"
 #include "common.h"
 /* USER CODE END Includes */
 
@@ -101,6 +106,11 @@ void HardFault_Handler(void)
 void MemManage_Handler(void)
 {
   /* USER CODE BEGIN MemoryManagement_IRQn 0 */
+#if MPU_STACK_GUARD
+  // only region the kernel programs is the stack guard so this is an overflow
+  extern task_t g_active_task_id;
+  osStackOverflowHook(g_active_task_id);
+#endif
 
   /* USER CODE END MemoryManagement_IRQn 0 */
   while (1)
@@ -185,33 +195,60 @@ void DebugMon_Handler(void)
 void SysTick_Handler(void)
 {
     HAL_IncTick();
+    k_time_tick();
 
     extern U8 g_kernel_initialized;
     extern U8 g_kernel_running;
-    extern TCB g_tasks[MAX_TASKS];
-    extern task_t g_active_task_id;
 
     if (g_kernel_initialized && g_kernel_running) {
         g_system_time++;
 
+#if PROF_ENABLED
+        // sample before any rescheduling changes the active task
+        k_prof_tick();
+#endif
+
         int need_reschedule = 0;
 
-        // Update task times
-        for (int i = 1; i < MAX_TASKS; i++) {
-            if (g_tasks[i].state == DORMANT) {
-                continue;
-            }
+#if TT_ENABLED
+        // table dispatch first, one lookup per tick
+        need_reschedule = tt_tick();
+#endif
+
+#if BUDGET_ENFORCE
+        // charge the running task its cycles, throttle or demote it on overrun
+        need_reschedule |= budget_tick();
+#endif
+
+#if TIMER_ENABLED
+        // software timers, wakes the daemon when this tick's slot is not empty
+        need_reschedule |= k_timer_tick();
+#endif
+
+        // charge the running bandwidth server, its deadline moves when the budget runs out
+        if (g_active_task_id != TID_NULL && g_tcb_table[g_active_task_id] != NULL &&
+            g_tcb_table[g_active_task_id]->server != NULL) {
+            need_reschedule |= k_cbs_tick(g_tcb_table[g_active_task_id]->server);
+        }
+
+#if SCHED_STATS
+        U32 start_cycles = DWT->CYCCNT;
+#endif
+
+        // Update task times, only live tasks are on the list
+        for (int k = 0; k < g_num_tasks; k++) {
+            task_t i = g_task_list[k];
 
             // Decrement time_left
-            if (g_tasks[i].time_left > 0) {
-                g_tasks[i].time_left--;
+            if (g_task_time_left[i] > 0) {
+                g_task_time_left[i]--;
 
                 // deadline expired
-                if (g_tasks[i].time_left == 0) {
+                if (g_task_time_left[i] == 0) {
                     // Wake up sleeping tasks
-                    if (g_tasks[i].state == SLEEPING) {
-                        g_tasks[i].state = READY;
-                        g_tasks[i].time_left = g_tasks[i].deadline_value;
+                    if (g_task_state[i] == SLEEPING) {
+                        g_task_state[i] = READY;
+                        g_task_time_left[i] = g_task_deadline[i];
                         need_reschedule = 1;
                     }
                     // running task need preempted
@@ -220,13 +257,25 @@ void SysTick_Handler(void)
                         // Don't reset timer here - let trigger_context_switch handle it
                     }
                     // Ready tasks
-                    else if (g_tasks[i].state == READY) {
-                        g_tasks[i].time_left = g_tasks[i].deadline_value;
+                    else if (g_task_state[i] == READY) {
+                        g_task_time_left[i] = g_task_deadline[i];
                     }
                 }
             }
+
+#if BUDGET_ENFORCE
+            // budget windows run apart from time_left
+            need_reschedule |= budget_window_tick(i);
+#endif
         }
 
+#if SCHED_STATS
+        g_sched_stats.tick_last = DWT->CYCCNT - start_cycles;
+        if (g_sched_stats.tick_last > g_sched_stats.tick_max) {
+            g_sched_stats.tick_max = g_sched_stats.tick_last;
+        }
+#endif
+
         // Trigger context switch if rescheduling is needed
         if (need_reschedule) {
             trigger_context_switch();
@@ -242,4 +291,12 @@ void SysTick_Handler(void)
 
 /* USER CODE BEGIN 1 */
 
+/**
+  * @brief This function handles TIM5 global interrupt, the k_time wake up compare.
+  */
+void TIM5_IRQHandler(void)
+{
+    k_time_timer_irq();
+}
+
 /* USER CODE END 1 */
@@ -5,7 +5,17 @@
 
 # Add inputs and outputs from these tool invocations to the build variables 
 C_SRCS += \
+../Core/Src/k_cbs.c \
+../Core/Src/k_log.c \
 ../Core/Src/k_mem.c \
+../Core/Src/k_mpu.c \
+../Core/Src/k_pool.c \
+../Core/Src/k_prof.c \
+../Core/Src/k_slab.c \
+../Core/Src/k_tasklet.c \
+../Core/Src/k_time.c \
+../Core/Src/k_timer.c \
+../Core/Src/k_workq.c \
 ../Core/Src/main.c \
 ../Core/Src/os_kernel.c \
 ../Core/Src/stm32f4xx_hal_msp.c \
@@ -16,7 +26,17 @@ C_SRCS += \
 ../Core/Src/util.c 
 
 OBJS += \
+./Core/Src/k_cbs.o \
+./Core/Src/k_log.o \
 ./Core/Src/k_mem.o \
+./Core/Src/k_mpu.o \
+./Core/Src/k_pool.o \
+./Core/Src/k_prof.o \
+./Core/Src/k_slab.o \
+./Core/Src/k_tasklet.o \
+./Core/Src/k_time.o \
+./Core/Src/k_timer.o \
+./Core/Src/k_workq.o \
 ./Core/Src/main.o \
 ./Core/Src/os_kernel.o \
 ./Core/Src/stm32f4xx_hal_msp.o \
@@ -27,7 +47,17 @@ OBJS += \
 ./Core/Src/util.o 
 
 C_DEPS += \
+./Core/Src/k_cbs.d \
+./Core/Src/k_log.d \
 ./Core/Src/k_mem.d \
+./Core/Src/k_mpu.d \
+./Core/Src/k_pool.d \
+./Core/Src/k_prof.d \
+./Core/Src/k_slab.d \
+./Core/Src/k_tasklet.d \
+./Core/Src/k_time.d \
+./Core/Src/k_timer.d \
+./Core/Src/k_workq.d \
 ./Core/Src/main.d \
 ./Core/Src/os_kernel.d \
 ./Core/Src/stm32f4xx_hal_msp.d \
@@ -45,7 +75,7 @@ Core/Src/%.o Core/Src/%.su Core/Src/%.cyclo: ../Core/Src/%.c Core/Src/subdir.mk
 clean: clean-Core-2f-Src
 
 clean-Core-2f-Src:
-	-$(RM) ./Core/Src/k_mem.cyclo ./Core/Src/k_mem.d ./Core/Src/k_mem.o ./Core/Src/k_mem.su ./Core/Src/main.cyclo ./Core/Src/main.d ./Core/Src/main.o ./Core/Src/main.su ./Core/Src/os_kernel.cyclo ./Core/Src/os_kernel.d ./Core/Src/os_kernel.o ./Core/Src/os_kernel.su ./Core/Src/stm32f4xx_hal_msp.cyclo ./Core/Src/stm32f4xx_hal_msp.d ./Core/Src/stm32f4xx_hal_msp.o ./Core/Src/stm32f4xx_hal_msp.su ./Core/Src/stm32f4xx_it.cyclo ./Core/Src/stm32f4xx_it.d ./Core/Src/stm32f4xx_it.o ./Core/Src/stm32f4xx_it.su ./Core/Src/syscalls.cyclo ./Core/Src/syscalls.d ./Core/Src/syscalls.o ./Core/Src/syscalls.su ./Core/Src/sysmem.cyclo ./Core/Src/sysmem.d ./Core/Src/sysmem.o ./Core/Src/sysmem.su ./Core/Src/system_stm32f4xx.cyclo ./Core/Src/system_stm32f4xx.d ./Core/Src/system_stm32f4xx.o ./Core/Src/system_stm32f4xx.su ./Core/Src/util.cyclo ./Core/Src/util.d ./Core/Src/util.o ./Core/Src/util.su
+	-$(RM) ./Core/Src/k_cbs.cyclo ./Core/Src/k_cbs.d ./Core/Src/k_cbs.o ./Core/Src/k_cbs.su ./Core/Src/k_log.cyclo ./Core/Src/k_log.d ./Core/Src/k_log.o ./Core/Src/k_log.su ./Core/Src/k_mem.cyclo ./Core/Src/k_mem.d ./Core/Src/k_mem.o ./Core/Src/k_mem.su ./Core/Src/k_mpu.cyclo ./Core/Src/k_mpu.d ./Core/Src/k_mpu.o ./Core/Src/k_mpu.su ./Core/Src/k_pool.cyclo ./Core/Src/k_pool.d ./Core/Src/k_pool.o ./Core/Src/k_pool.su ./Core/Src/k_prof.cyclo ./Core/Src/k_prof.d ./Core/Src/k_prof.o ./Core/Src/k_prof.su ./Core/Src/k_slab.cyclo ./Core/Src/k_slab.d ./Core/Src/k_slab.o ./Core/Src/k_slab.su ./Core/Src/k_tasklet.cyclo ./Core/Src/k_tasklet.d ./Core/Src/k_tasklet.o ./Core/Src/k_tasklet.su ./Core/Src/k_time.cyclo ./Core/Src/k_time.d ./Core/Src/k_time.o ./Core/Src/k_time.su ./Core/Src/k_timer.cyclo ./Core/Src/k_timer.d ./Core/Src/k_timer.o ./Core/Src/k_timer.su ./Core/Src/k_workq.cyclo ./Core/Src/k_workq.d ./Core/Src/k_workq.o ./Core/Src/k_workq.su ./Core/Src/main.cyclo ./Core/Src/main.d ./Core/Src/main.o ./Core/Src/main.su ./Core/Src/os_kernel.cyclo ./Core/Src/os_kernel.d ./Core/Src/os_kernel.o ./Core/Src/os_kernel.su ./Core/Src/stm32f4xx_hal_msp.cyclo ./Core/Src/stm32f4xx_hal_msp.d ./Core/Src/stm32f4xx_hal_msp.o ./Core/Src/stm32f4xx_hal_msp.su ./Core/Src/stm32f4xx_it.cyclo ./Core/Src/stm32f4xx_it.d ./Core/Src/stm32f4xx_it.o ./Core/Src/stm32f4xx_it.su ./Core/Src/syscalls.cyclo ./Core/Src/syscalls.d ./Core/Src/syscalls.o ./Core/Src/syscalls.su ./Core/Src/sysmem.cyclo ./Core/Src/sysmem.d ./Core/Src/sysmem.o ./Core/Src/sysmem.su ./Core/Src/system_stm32f4xx.cyclo ./Core/Src/system_stm32f4xx.d ./Core/Src/system_stm32f4xx.o ./Core/Src/system_stm32f4xx.su ./Core/Src/util.cyclo ./Core/Src/util.d ./Core/Src/util.o ./Core/Src/util.su
 
 .PHONY: clean-Core-2f-Src
 
@@ -0,0 +1,101 @@
+// heap fragmentation after mixed churn, with and without the long-lived hint
+//   run.sh bench_churn.c -DSIM_HEAP=73728 [-DHINT=0] [-DROUNDS=200000]
+// 64 slots of transient 16-616 byte buffers and 24 slots of 1-2.5 KB blocks
+// that are replaced now and then. HINT=1 (default) allocates the big blocks
+// with MEM_LONG_LIVED, HINT=0 with plain first fit. After the rounds every
+// transient buffer is freed and the free space is measured
+#include <stddef.h>
+#include "common.h"
+#include "k_task.h"
+#include "k_mem.h"
+
+#ifndef HINT
+#define HINT 1
+#endif
+
+#ifndef ROUNDS
+#define ROUNDS 200000
+#endif
+
+#define N_TRANSIENT 64
+#define N_LONG 24
+
+unsigned char sim_arena[SIM_HEAP] __attribute__((aligned(8)));
+extern void sim_finish(void);
+extern int sim_printf(const char* f, ...);
+
+static TCB bench_task;
+static void* transient[N_TRANSIENT];
+static void* long_lived[N_LONG];
+static U32 seed = 12345;
+
+static U32 rnd(U32 n) {
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % n;
+}
+
+// smallest size no free block is below, extfrag counts blocks smaller than its argument
+static U32 largest_free(void) {
+    int total = k_mem_count_extfrag(SIM_HEAP + 1);
+    U32 lo = 0, hi = SIM_HEAP;
+    while (lo < hi) {
+        U32 mid = (lo + hi + 1) / 2;
+        if (k_mem_count_extfrag(mid) < total) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
+
+static void bench(void* args) {
+    U32 failed = 0;
+
+    for (U32 r = 0; r < ROUNDS; r++) {
+        int i = rnd(N_TRANSIENT);
+        if (transient[i] != NULL) {
+            k_mem_dealloc(transient[i]);
+            transient[i] = NULL;
+        } else {
+            transient[i] = k_mem_alloc(16 + rnd(601));
+            failed += transient[i] == NULL;
+        }
+
+        // about one long-lived replacement per 64 rounds
+        if (rnd(64) == 0) {
+            int j = rnd(N_LONG);
+            if (long_lived[j] != NULL) {
+                k_mem_dealloc(long_lived[j]);
+            }
+            long_lived[j] = k_mem_alloc_hint(1024 + rnd(1537), HINT ? MEM_LONG_LIVED : MEM_TRANSIENT);
+            failed += long_lived[j] == NULL;
+        }
+    }
+
+    for (int i = 0; i < N_TRANSIENT; i++) {
+        if (transient[i] != NULL) {
+            k_mem_dealloc(transient[i]);
+        }
+    }
+
+    sim_printf("hint %s, %u rounds, %u failed allocations\n", HINT ? "on " : "off", ROUNDS, failed);
+    sim_printf("  free blocks %d, below 4096: %d, below 16384: %d, largest %u bytes\n",
+               k_mem_count_extfrag(SIM_HEAP + 1), k_mem_count_extfrag(4096), k_mem_count_extfrag(16384),
+               largest_free());
+    sim_finish();
+}
+
+int sim_main(void) {
+    osKernelInit();
+
+    bench_task.ptask = bench;
+    bench_task.stack_size = STACK_SIZE;
+    if (osCreateDeadlineTask(1000, &bench_task) != RTX_OK) {
+        sim_printf("create bench failed\n");
+        return 1;
+    }
+
+    osKernelStart();
+    return 0;
+}
@@ -0,0 +1,142 @@
+// scheduler, tick, spawn and TCB allocation cost against the number of live tasks
+//   run.sh bench_sched.c -DLIVE=64 [-DMAX_TASKS=256] [-DSIM_HEAP="(512*1024)"]
+// every figure is the median in host cycles
+#include "common.h"
+#include "k_task.h"
+#include "k_mem.h"
+#include "k_pool.h"
+
+#ifndef LIVE
+#define LIVE 16
+#endif
+
+#define PROBES 1001
+#define SPAWNS 101
+#define TICKS 1001
+
+unsigned char sim_arena[SIM_HEAP] __attribute__((aligned(8)));
+extern uint64_t sim_rdtsc(void);
+extern uint32_t* sim_tick_samples;
+extern U32 sim_tick_nsamples, sim_tick_cap;
+extern void sim_work(uint64_t us);
+extern void sim_finish(void);
+extern int sim_printf(const char* f, ...);
+extern void sim_flush(void);
+extern void sim_exit(int code);
+
+static TCB tasks[LIVE];
+static TCB bench_task;
+static TCB spawn_task;
+static uint32_t samples[PROBES];
+static uint32_t tick_samples[TICKS];
+static k_pool_t pool;
+
+static uint32_t median(uint32_t* v, int n) {
+    for (int i = 1; i < n; i++) {
+        uint32_t x = v[i];
+        int j = i;
+        while (j > 0 && v[j - 1] > x) {
+            v[j] = v[j - 1];
+            j--;
+        }
+        v[j] = x;
+    }
+    return v[n / 2];
+}
+
+// periodic load, each releases once per deadline and does no work
+static void idle_periodic(void* args) {
+    while (1) {
+        osPeriodYield();
+    }
+}
+
+static void spawned(void* args) {
+}
+
+static void bench(void* args) {
+    // let every periodic task run once
+    osSleep(100);
+
+    // cost of the timestamps themselves, taken off every probe
+    for (int i = 0; i < PROBES; i++) {
+        uint64_t t0 = sim_rdtsc();
+        samples[i] = (uint32_t)(sim_rdtsc() - t0);
+    }
+    uint32_t overhead = median(samples, PROBES);
+
+    for (int i = 0; i < PROBES; i++) {
+        uint64_t t0 = sim_rdtsc();
+        edf_scheduler();
+        samples[i] = (uint32_t)(sim_rdtsc() - t0);
+    }
+    uint32_t sched = median(samples, PROBES) - overhead;
+
+    // a second of busy work while the periodic tasks keep getting released
+    sim_tick_samples = tick_samples;
+    sim_tick_cap = TICKS;
+    sim_work(TICKS * 1000);
+    uint32_t tick = median(tick_samples, sim_tick_nsamples) - overhead;
+    sim_tick_cap = 0;
+
+    // create and let exit, TCB from the pool and stack from the heap
+    for (int i = 0; i < SPAWNS; i++) {
+        spawn_task.ptask = spawned;
+        spawn_task.stack_size = STACK_SIZE;
+        uint64_t t0 = sim_rdtsc();
+        if (osCreateTask(&spawn_task) != RTX_OK) {
+            sim_printf("spawn failed\n");
+            sim_flush();
+            sim_exit(1);
+        }
+        samples[i] = (uint32_t)(sim_rdtsc() - t0);
+        osYield();
+    }
+    uint32_t spawn = median(samples, SPAWNS) - overhead;
+
+    // one TCB from a pool against the same size from the heap, with every stack live
+    k_pool_init(&pool, sizeof(k_tcb_t), TCB_POOL_CHUNK);
+    k_pool_free(&pool, k_pool_alloc(&pool));
+    for (int i = 0; i < PROBES; i++) {
+        uint64_t t0 = sim_rdtsc();
+        void* p = k_pool_alloc(&pool);
+        samples[i] = (uint32_t)(sim_rdtsc() - t0);
+        k_pool_free(&pool, p);
+    }
+    uint32_t pool_alloc = median(samples, PROBES) - overhead;
+    for (int i = 0; i < PROBES; i++) {
+        uint64_t t0 = sim_rdtsc();
+        void* p = k_mem_alloc(sizeof(k_tcb_t));
+        samples[i] = (uint32_t)(sim_rdtsc() - t0);
+        k_mem_dealloc(p);
+    }
+    uint32_t heap_alloc = median(samples, PROBES) - overhead;
+
+    sim_printf("MAX_TASKS %3d live %3d | edf_scheduler %4u | SysTick %4u | osCreateTask %4u | "
+               "TCB k_pool_alloc %3u k_mem_alloc %4u\n",
+               MAX_TASKS, g_num_tasks, sched, tick, spawn, pool_alloc, heap_alloc);
+    sim_finish();
+}
+
+int sim_main(void) {
+    osKernelInit();
+
+    // LIVE - 1 periodic tasks with deadlines spread over 5..36 ms, plus the bench
+    for (int i = 0; i < LIVE - 1; i++) {
+        tasks[i].ptask = idle_periodic;
+        tasks[i].stack_size = STACK_SIZE;
+        if (osCreateDeadlineTask(5 + i % 32, &tasks[i]) != RTX_OK) {
+            sim_printf("create %d failed\n", i);
+            return 1;
+        }
+    }
+    bench_task.ptask = bench;
+    bench_task.stack_size = STACK_SIZE;
+    if (osCreateDeadlineTask(40, &bench_task) != RTX_OK) {
+        sim_printf("create bench failed\n");
+        return 1;
+    }
+
+    osKernelStart();
+    return 0;
+}
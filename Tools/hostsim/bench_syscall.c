@@ -0,0 +1,211 @@
+// round trip of each system call, table dispatch against the switch it replaced
+//   run.sh bench_syscall.c -DSCHED_STATS=1
+// table: SVC_Handler_Main, the number in the stacked r12 indexes syscall_table.
+// switch: the handler before 2debf39, copied below. It reads the number back
+// from the svc instruction through the stacked PC and switches on it.
+// Both get the same 8 word frame and are timed with the same DWT reads, so the
+// figures are frame, dispatch and handler in host cycles (medians). The
+// exception entry and the stub's register moves are the same on both sides
+// and not in the sim
+#include "common.h"
+#include "k_task.h"
+#include "k_mem.h"
+#include "k_syscall.h"
+#include "k_crit.h"
+
+#if !SCHED_STATS
+#error build with -DSCHED_STATS=1
+#endif
+
+#define PROBES 1001
+
+unsigned char sim_arena[SIM_HEAP] __attribute__((aligned(8)));
+extern uint64_t sim_rdtsc(void);
+extern void sim_finish(void);
+extern int sim_printf(const char* f, ...);
+extern void SVC_Handler_Main(unsigned int* svc_args);
+
+static TCB bench_task;
+static U32 samples[PROBES];
+static U32 switch_samples[PROBES];
+
+// old svc numbers, the immediate of the svc instruction
+#define OLD_SET_DEADLINE 4
+#define OLD_TASK_INFO 5
+#define OLD_MEM_ALLOC 8
+#define OLD_MEM_DEALLOC 9
+#define OLD_MEM_EXTFRAG 10
+#define OLD_GET_TID 15
+
+// the cases that only call an _impl function or touch globals, yield, start and
+// exit need the kernel's statics and are left out
+__attribute__((noinline)) static void old_svc_handler_main(unsigned int* svc_args) {
+    uint8_t svc_number = ((char*)svc_args[6])[-2];
+
+    switch (svc_number) {
+    case 2:
+        svc_args[0] = osCreateTask_impl((TCB*)svc_args[0]);
+        break;
+    case 3:
+        svc_args[0] = osCreateDeadlineTask_impl(svc_args[0], (TCB*)svc_args[1]);
+        break;
+    case 4: {
+        int deadline = svc_args[0];
+        task_t tid = svc_args[1];
+        svc_args[0] = RTX_ERR;
+        if (deadline > 0 && tid < MAX_TASKS &&
+            (g_task_state[tid] == READY || g_task_state[tid] == RUNNING)) {
+            U32 crit = k_crit_enter();
+            g_task_deadline[tid] = deadline;
+            g_task_time_left[tid] = deadline;
+            if (g_active_task_id != TID_NULL &&
+                g_task_deadline[tid] < g_task_deadline[g_active_task_id]) {
+                k_crit_exit(crit);
+                trigger_context_switch();
+                return;
+            }
+            k_crit_exit(crit);
+            svc_args[0] = RTX_OK;
+        }
+    } break;
+    case 5:
+        svc_args[0] = osTaskInfo_impl(svc_args[0], (TCB*)svc_args[1]);
+        break;
+    case 6:
+        svc_args[0] = osCreateServerTask_impl((struct k_cbs*)svc_args[0], (TCB*)svc_args[1]);
+        break;
+    case 7:
+        svc_args[0] = k_mem_init_impl();
+        break;
+    case 8:
+        svc_args[0] = (unsigned int)k_mem_alloc_impl(svc_args[0]);
+        break;
+    case 9:
+        svc_args[0] = k_mem_dealloc_impl((void*)svc_args[0]);
+        break;
+    case 10:
+        svc_args[0] = k_mem_count_extfrag_impl(svc_args[0]);
+        break;
+    case 15:
+        svc_args[0] = g_active_task_id;
+        break;
+    case 18:
+        osKernelInit_impl();
+        break;
+    default:
+        break;
+    }
+}
+
+// one "svc #imm" per number, little endian Thumb: imm then 0xDF
+static uint8_t svc_insn[19][2];
+
+static U32 table_svc(U32 nr, U32 a0, U32 a1, U32* cycles) {
+    U32 sys_start = SYSCALL_CYCCNT;
+    unsigned int frame[8] = {a0, a1, 0, 0, nr, 0, (unsigned int)&svc_insn[0][2], 0x01000000};
+    SVC_Handler_Main(frame);
+    *cycles = SYSCALL_CYCCNT - sys_start;
+    return frame[0];
+}
+
+static U32 switch_svc(U32 imm, U32 a0, U32 a1, U32* cycles) {
+    U32 sys_start = SYSCALL_CYCCNT;
+    unsigned int frame[8] = {a0, a1, 0, 0, 0, 0, (unsigned int)&svc_insn[imm][2], 0x01000000};
+    old_svc_handler_main(frame);
+    *cycles = SYSCALL_CYCCNT - sys_start;
+    return frame[0];
+}
+
+static U32 median(U32* v, int n) {
+    for (int i = 1; i < n; i++) {
+        U32 x = v[i];
+        int j = i;
+        while (j > 0 && v[j - 1] > x) {
+            v[j] = v[j - 1];
+            j--;
+        }
+        v[j] = x;
+    }
+    return v[n / 2];
+}
+
+static U32 overhead;
+
+static void report(const char* name) {
+    sim_printf("%-18s %6d %7d\n", name, (int)(median(samples, PROBES) - overhead),
+               (int)(median(switch_samples, PROBES) - overhead));
+}
+
+static void bench(void* args) {
+    task_t self = osGetTID();
+    TCB copy;
+
+    for (int i = 0; i < 19; i++) {
+        svc_insn[i][0] = i;
+        svc_insn[i][1] = 0xDF;
+    }
+
+    for (int i = 0; i < PROBES; i++) {
+        U32 t0 = *sim_cyccnt();
+        samples[i] = *sim_cyccnt() - t0;
+    }
+    overhead = median(samples, PROBES);
+
+    sim_printf("%-18s %6s %7s\n", "", "table", "switch");
+
+    // no handler work, the dispatch alone
+    for (int i = 0; i < PROBES; i++) {
+        table_svc(SYS_GET_TID, 0, 0, &samples[i]);
+        switch_svc(OLD_GET_TID, 0, 0, &switch_samples[i]);
+    }
+    report("SYS_GET_TID");
+
+    for (int i = 0; i < PROBES; i++) {
+        table_svc(SYS_SET_DEADLINE, 40, self, &samples[i]);
+        switch_svc(OLD_SET_DEADLINE, 40, self, &switch_samples[i]);
+    }
+    report("SYS_SET_DEADLINE");
+
+    for (int i = 0; i < PROBES; i++) {
+        table_svc(SYS_TASK_INFO, self, (U32)&copy, &samples[i]);
+        switch_svc(OLD_TASK_INFO, self, (U32)&copy, &switch_samples[i]);
+    }
+    report("SYS_TASK_INFO");
+
+    U32 alloc[PROBES], switch_alloc[PROBES];
+    for (int i = 0; i < PROBES; i++) {
+        void* p = (void*)table_svc(SYS_MEM_ALLOC, 64, MEM_TRANSIENT, &alloc[i]);
+        table_svc(SYS_MEM_DEALLOC, (U32)p, 0, &samples[i]);
+
+        p = (void*)switch_svc(OLD_MEM_ALLOC, 64, 0, &switch_alloc[i]);
+        switch_svc(OLD_MEM_DEALLOC, (U32)p, 0, &switch_samples[i]);
+    }
+    report("SYS_MEM_DEALLOC");
+    for (int i = 0; i < PROBES; i++) {
+        samples[i] = alloc[i];
+        switch_samples[i] = switch_alloc[i];
+    }
+    report("SYS_MEM_ALLOC");
+
+    for (int i = 0; i < PROBES; i++) {
+        table_svc(SYS_MEM_EXTFRAG, 128, 0, &samples[i]);
+        switch_svc(OLD_MEM_EXTFRAG, 128, 0, &switch_samples[i]);
+    }
+    report("SYS_MEM_EXTFRAG");
+
+    sim_finish();
+}
+
+int sim_main(void) {
+    osKernelInit();
+
+    bench_task.ptask = bench;
+    bench_task.stack_size = STACK_SIZE;
+    if (osCreateDeadlineTask(40, &bench_task) != RTX_OK) {
+        sim_printf("create bench failed\n");
+        return 1;
+    }
+
+    osKernelStart();
+    return 0;
+}
@@ -0,0 +1,72 @@
+// context switches with and without preemption thresholds
+//   run.sh bench_threshold.c -DSCHED_STATS=1 [-DTHRESHOLD=1] [-DEND_MS=10000]
+// three periodic tasks whose releases drift against each other, so jobs get
+// released in the middle of other jobs; THRESHOLD=1 makes them mutually
+// non-preemptive (threshold 5, below every deadline)
+// switches only: every task has its own stack, so thresholds cannot change
+// stack use here (and the sim's high-water marks are host stacks anyway)
+#include "common.h"
+#include "k_task.h"
+
+#if !SCHED_STATS
+#error build with -DSCHED_STATS=1
+#endif
+
+#ifndef THRESHOLD
+#define THRESHOLD 0
+#endif
+
+#ifndef END_MS
+#define END_MS 10000
+#endif
+
+#define N_TASKS 3
+
+unsigned char sim_arena[SIM_HEAP] __attribute__((aligned(8)));
+extern uint64_t sim_end_us, sim_task_us[];
+extern void sim_work(uint64_t us);
+extern int sim_printf(const char* f, ...);
+
+static const U32 deadline_ms[N_TASKS] = {5, 7, 11};
+static const U32 work_us[N_TASKS] = {1300, 2300, 2700};
+static TCB tasks[N_TASKS];
+static U32 jobs[N_TASKS];
+
+static void periodic(void* args) {
+    int i = (int)args;
+    while (1) {
+        sim_work(work_us[i]);
+        jobs[i]++;
+        osPeriodYield();
+    }
+}
+
+void sim_report(void) {
+    sim_printf("threshold %s: switches %u, reschedules skipped %u\n", THRESHOLD ? "on " : "off",
+               g_sched_stats.switches, g_sched_stats.preempt_skipped);
+    for (int i = 0; i < N_TASKS; i++) {
+        sim_printf("  deadline %2u ms: %u jobs, %u us of CPU\n", deadline_ms[i], jobs[i],
+                   (U32)sim_task_us[tasks[i].tid]);
+    }
+}
+
+int sim_main(void) {
+    sim_end_us = END_MS * 1000ULL;
+    osKernelInit();
+
+    for (int i = 0; i < N_TASKS; i++) {
+        tasks[i].ptask = periodic;
+        tasks[i].args = (void*)i;
+        tasks[i].stack_size = STACK_SIZE;
+        if (osCreateDeadlineTask(deadline_ms[i], &tasks[i]) != RTX_OK) {
+            sim_printf("create failed\n");
+            return 1;
+        }
+#if THRESHOLD
+        osSetPreemptThreshold(tasks[i].tid, 5);
+#endif
+    }
+
+    osKernelStart();
+    return 0;
+}
@@ -0,0 +1,28 @@
+// the demo application from main.c, scheduler counters printed at the end
+//   run.sh demo.c -DSCHED_STATS=1 [-DDEMO_THRESHOLD=1] [-DEND_MS=10000] [-DECHO=1]
+unsigned char sim_arena[SIM_HEAP] __attribute__((aligned(8)));
+#define main sim_app_main
+#include "main.c"
+#undef main
+extern uint64_t sim_end_us, sim_now_us, sim_task_us[];
+extern int sim_uart_echo;
+extern int sim_printf(const char* f, ...);
+void sim_report(void) {
+    sim_printf("t=%llu ms i_test=%d i_test2=%d switches=%u skipped=%u\n", sim_now_us / 1000, i_test, i_test2,
+               g_sched_stats.switches, g_sched_stats.preempt_skipped);
+    sim_printf("cpu us A=%llu B=%llu C=%llu idle/null=%llu\n", sim_task_us[task_a_tcb.tid], sim_task_us[task_b_tcb.tid],
+               sim_task_us[task_c_tcb.tid], sim_task_us[0]);
+    sim_printf("hwm A=%u B=%u C=%u jit %u/%u over %u rel %u\n", task_stack_high_water(task_a_tcb.tid),
+               task_stack_high_water(task_b_tcb.tid), task_stack_high_water(task_c_tcb.tid),
+               task_a_tcb.period_stats.jitter_last_us, task_a_tcb.period_stats.jitter_max_us,
+               task_a_tcb.period_stats.overruns, task_a_tcb.period_stats.releases);
+}
+int sim_main(void) {
+#ifdef ECHO
+    sim_uart_echo = 1;
+#endif
+#ifdef END_MS
+    sim_end_us = END_MS * 1000ULL;
+#endif
+    return sim_app_main();
+}
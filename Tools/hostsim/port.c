@@ -0,0 +1,242 @@
+// Cortex-M pieces the kernel expects, modelled on the host: SysTick, SVC,
+// PendSV with one coroutine per task, a us clock and UART time for printf
+#include <stdint.h>
+#include <stdarg.h>
+#include "common.h"
+#include "k_task.h"
+#include "k_syscall.h"
+#include "stm32f4xx.h"
+
+#define SIM_TASK_STACK (64 * 1024)
+
+extern void sim_exit(int code);
+extern void sim_flush(void);
+extern int sim_vformat(char* out, unsigned cap, const char* f, va_list ap);
+extern int sim_printf(const char* f, ...);
+extern uint64_t sim_rdtsc(void);
+extern void co_switch(uint32_t** save, uint32_t* next);
+extern uint32_t* co_init(uint32_t* top, void (*entry)(void));
+
+extern void SysTick_Handler(void);
+extern void SVC_Handler_Main(unsigned int* svc_args);
+extern void perform_context_switch(void);
+extern U8 g_kernel_running;
+
+static uint8_t regs[0x10000];
+U32 sim_basepri = 0;
+uint32_t sim_psp = 0;
+
+// simulated time
+uint64_t sim_now_us = 0;
+static uint64_t next_tick_us = 1000;
+uint64_t sim_end_us = 10ULL * 1000 * 1000;
+int sim_uart_echo = 0;                 // print task output
+U32 sim_uart_us_per_char = 87;         // 115200 8N1
+U32 sim_ticks = 0;
+
+// coroutines
+static uint8_t co_stack[MAX_TASKS][SIM_TASK_STACK] __attribute__((aligned(16)));
+static uint32_t* co_sp[MAX_TASKS];
+static uint8_t co_valid[MAX_TASKS];
+static uint32_t* main_sp;
+static uint32_t* dead_sp;
+static int in_isr = 0;
+task_t sim_cur = TID_NULL;
+
+// cpu time charged to each TID (us) while it was the running coroutine
+uint64_t sim_task_us[MAX_TASKS];
+
+__attribute__((weak)) void sim_report(void) {
+}
+
+void* sim_reg(uint32_t addr) {
+    return &regs[addr & 0xFFFF];
+}
+
+// host cycles for the benches, a harness that checks CPU budgets sets
+// sim_cycles_from_time so DWT counts the simulated time instead
+static volatile uint32_t cyccnt;
+int sim_cycles_from_time = 0;
+extern uint32_t SystemCoreClock;
+volatile uint32_t* sim_cyccnt(void) {
+    if (sim_cycles_from_time) {
+        cyccnt = (uint32_t)(sim_now_us * (SystemCoreClock / 1000000));
+    } else {
+        cyccnt = (uint32_t)sim_rdtsc();
+    }
+    return &cyccnt;
+}
+
+DWT_Type* sim_dwt(void) {
+    DWT_Type* dwt = (DWT_Type*)sim_reg(DWT_BASE);
+    dwt->CYCCNT = (uint32_t)sim_rdtsc();
+    return dwt;
+}
+
+#define ICSR (*(volatile uint32_t*)sim_reg(0xE000ED04UL))
+#define PENDSVSET (1UL << 28)
+
+void sim_finish(void) {
+    sim_report();
+    sim_flush();
+    sim_exit(0);
+}
+
+static void task_entry(void) {
+    k_tcb_t* tcb = g_tcb_table[sim_cur];
+    tcb->ptask(tcb->args);
+    osTaskExit();
+    for (;;) {
+        sim_wfi();
+    }
+}
+
+// PendSV: the kernel picks the task, the sim swaps coroutines
+static void sim_pendsv(void) {
+    ICSR &= ~PENDSVSET;
+    task_t from = sim_cur;
+    perform_context_switch();
+    task_t to = g_active_task_id;
+    if (to == from) {
+        return;
+    }
+
+    uint32_t** save = &co_sp[from];
+    if (g_task_state[from] == DORMANT) {
+        co_valid[from] = 0;
+        save = &dead_sp;
+    }
+    if (!co_valid[to]) {
+        co_sp[to] = co_init((uint32_t*)(co_stack[to] + SIM_TASK_STACK), task_entry);
+        co_valid[to] = 1;
+    }
+    sim_cur = to;
+    co_switch(save, co_sp[to]);
+}
+
+static void pendsv_check(void) {
+    if ((ICSR & PENDSVSET) && sim_basepri == 0 && !in_isr) {
+        sim_pendsv();
+    }
+}
+
+void sim_crit_released(void) {
+    pendsv_check();
+}
+
+uint64_t sim_tick_cycles = 0;
+uint32_t* sim_tick_samples = 0;        // harness buffer for per tick cycles
+U32 sim_tick_nsamples = 0;
+U32 sim_tick_cap = 0;
+
+static void sim_systick(void) {
+    sim_ticks++;
+    in_isr = 1;
+    uint64_t t0 = sim_rdtsc();
+    SysTick_Handler();
+    uint64_t cycles = sim_rdtsc() - t0;
+    sim_tick_cycles += cycles;
+    if (sim_tick_nsamples < sim_tick_cap) {
+        sim_tick_samples[sim_tick_nsamples++] = (uint32_t)cycles;
+    }
+    in_isr = 0;
+    if (sim_now_us >= sim_end_us) {
+        sim_finish();
+    }
+    pendsv_check();
+}
+
+// the running task spends us of CPU time, SysTick fires on the way
+void sim_work(uint64_t us) {
+    while (us > 0) {
+        uint64_t step = next_tick_us - sim_now_us;
+        if (step > us) {
+            step = us;
+        }
+        sim_now_us += step;
+        sim_task_us[sim_cur] += step;
+        us -= step;
+        if (sim_now_us == next_tick_us) {
+            next_tick_us += 1000;
+            sim_systick();
+        }
+    }
+}
+
+void sim_wfi(void) {
+    uint64_t step = next_tick_us - sim_now_us;
+    sim_now_us += step;
+    next_tick_us += 1000;
+    sim_systick();
+}
+
+U32 sim_svc(U32 nr, U32 a0, U32 a1, U32 a2, U32 a3) {
+    unsigned int frame[8] = {a0, a1, a2, a3, nr, 0, 0, 0x01000000};
+    SVC_Handler_Main(frame);
+    pendsv_check();
+    return frame[0];
+}
+
+// asm entry in svc_handler.s: switch to the first task, never comes back
+void start_first_task(void) {
+    perform_context_switch();
+    task_t to = g_active_task_id;
+    co_sp[to] = co_init((uint32_t*)(co_stack[to] + SIM_TASK_STACK), task_entry);
+    co_valid[to] = 1;
+    sim_cur = to;
+    co_switch(&main_sp, co_sp[to]);
+}
+
+// printf holds the CPU while the UART shifts the text out
+int printf(const char* f, ...) {
+    char buf[512];
+    va_list ap;
+    va_start(ap, f);
+    int n = sim_vformat(buf, sizeof(buf), f, ap);
+    va_end(ap);
+    if (sim_uart_echo) {
+        sim_printf("%s", buf);
+    }
+    if (g_kernel_running && sim_cur != TID_NULL) {
+        sim_work((uint64_t)n * sim_uart_us_per_char);
+    }
+    return n;
+}
+
+int puts(const char* s) {
+    return printf("%s\n", s);
+}
+
+// k_time.c drives TIM5, the sim only needs the tick relative part
+void k_time_init(void) {
+}
+void k_time_tick(void) {
+}
+void k_time_timer_irq(void) {
+}
+U32 k_time_us_since_tick(U32 tick) {
+    return (U32)(sim_now_us - (uint64_t)tick * 1000);
+}
+
+// HAL bits main.c and the vector file touch
+volatile uint32_t uwTick;
+HAL_StatusTypeDef HAL_Init(void) {
+    return HAL_OK;
+}
+void HAL_IncTick(void) {
+    uwTick++;
+}
+uint32_t HAL_GetTick(void) {
+    return uwTick;
+}
+void SystemClock_Config(void) {
+}
+void MX_GPIO_Init(void) {
+}
+void MX_USART2_UART_Init(void) {
+}
+void Error_Handler(void) {
+    sim_printf("Error_Handler\n");
+    sim_finish();
+}
+uint32_t SystemCoreClock = 84000000;
@@ -0,0 +1,146 @@
+// freestanding i386 runtime for the kernel host sim: output, printf, coroutines
+#include <stdint.h>
+#include <stdarg.h>
+
+static int sys_write(int fd, const void* b, unsigned n) {
+    int r;
+    __asm volatile ("int $0x80" : "=a" (r) : "a" (4), "b" (fd), "c" (b), "d" (n) : "memory");
+    return r;
+}
+
+void sim_exit(int code) {
+    __asm volatile ("int $0x80" : : "a" (1), "b" (code));
+    for (;;) {
+    }
+}
+
+void* memset(void* d, int c, unsigned n) { unsigned char* p = d; while (n--) *p++ = c; return d; }
+void* memcpy(void* d, const void* s, unsigned n) { unsigned char* p = d; const unsigned char* q = s; while (n--) *p++ = *q++; return d; }
+void* memmove(void* d, const void* s, unsigned n) {
+    unsigned char* p = d; const unsigned char* q = s;
+    if (p < q) { while (n--) *p++ = *q++; } else { p += n; q += n; while (n--) *--p = *--q; }
+    return d;
+}
+int memcmp(const void* a, const void* b, unsigned n) {
+    const unsigned char* p = a; const unsigned char* q = b;
+    for (; n; n--, p++, q++) if (*p != *q) return *p - *q;
+    return 0;
+}
+
+uint64_t __udivdi3(uint64_t n, uint64_t d) {
+    uint64_t q = 0, r = 0;
+    for (int i = 63; i >= 0; i--) {
+        r = (r << 1) | ((n >> i) & 1);
+        if (r >= d) { r -= d; q |= 1ULL << i; }
+    }
+    return q;
+}
+uint64_t __umoddi3(uint64_t n, uint64_t d) { return n - __udivdi3(n, d) * d; }
+
+static char outbuf[4096];
+static unsigned outlen;
+
+void sim_flush(void) {
+    sys_write(1, outbuf, outlen);
+    outlen = 0;
+}
+
+static void outc(char c) {
+    if (outlen == sizeof(outbuf)) sim_flush();
+    outbuf[outlen++] = c;
+}
+
+static int fmt_num(char* buf, uint64_t v, int base, int neg) {
+    char tmp[24]; int n = 0, len = 0;
+    do { tmp[n++] = "0123456789abcdef"[v % base]; v /= base; } while (v);
+    if (neg) buf[len++] = '-';
+    while (n) buf[len++] = tmp[--n];
+    return len;
+}
+
+// %d %i %u %x %p %s %c with l/ll/z, width and -, enough for the kernel and demos
+int sim_vformat(char* out, unsigned cap, const char* f, va_list ap) {
+    unsigned n = 0;
+#define PUT(c) do { if (n + 1 < cap) out[n] = (c); n++; } while (0)
+    for (; *f; f++) {
+        if (*f != '%') { PUT(*f); continue; }
+        f++;
+        int zero = 0, left = 0, width = 0, lng = 0;
+        if (*f == '-') { left = 1; f++; }
+        if (*f == '0') { zero = 1; f++; }
+        while (*f >= '0' && *f <= '9') width = width * 10 + (*f++ - '0');
+        while (*f == 'l' || *f == 'z' || *f == 'h') { if (*f == 'l') lng++; f++; }
+        char num[32]; int len = 0; const char* s = num;
+        switch (*f) {
+            case 'd': case 'i': {
+                int64_t v = lng >= 2 ? va_arg(ap, int64_t) : va_arg(ap, int);
+                len = fmt_num(num, v < 0 ? -v : v, 10, v < 0); break;
+            }
+            case 'u': { uint64_t v = lng >= 2 ? va_arg(ap, uint64_t) : va_arg(ap, unsigned); len = fmt_num(num, v, 10, 0); break; }
+            case 'x': { uint64_t v = lng >= 2 ? va_arg(ap, uint64_t) : va_arg(ap, unsigned); len = fmt_num(num, v, 16, 0); break; }
+            case 'p': { num[0] = '0'; num[1] = 'x'; len = 2 + fmt_num(num + 2, (uintptr_t)va_arg(ap, void*), 16, 0); break; }
+            case 's': { s = va_arg(ap, const char*); while (s[len]) len++; break; }
+            case 'c': num[0] = (char)va_arg(ap, int); len = 1; break;
+            default: num[0] = *f; len = 1; break;
+        }
+        for (int i = len; i < width && !left; i++) PUT(zero ? '0' : ' ');
+        for (int i = 0; i < len; i++) PUT(s[i]);
+        for (int i = len; i < width && left; i++) PUT(' ');
+    }
+    if (cap) out[n < cap ? n : cap - 1] = 0;
+    return n;
+#undef PUT
+}
+
+int sim_printf(const char* f, ...) {
+    char buf[512];
+    va_list ap;
+    va_start(ap, f);
+    int n = sim_vformat(buf, sizeof(buf), f, ap);
+    va_end(ap);
+    for (int i = 0; i < n && i < (int)sizeof(buf) - 1; i++) outc(buf[i]);
+    return n;
+}
+
+uint64_t sim_rdtsc(void) {
+    uint32_t lo, hi;
+    __asm volatile ("lfence; rdtsc" : "=a" (lo), "=d" (hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+// coroutine switch, saves callee saved regs on the old stack
+__asm__(
+    ".globl co_switch\n"
+    "co_switch:\n"
+    "  movl 4(%esp), %eax\n"      // uint32_t** save
+    "  movl 8(%esp), %edx\n"      // uint32_t* next
+    "  pushl %ebp\n pushl %ebx\n pushl %esi\n pushl %edi\n"
+    "  movl %esp, (%eax)\n"
+    "  movl %edx, %esp\n"
+    "  popl %edi\n popl %esi\n popl %ebx\n popl %ebp\n"
+    "  ret\n");
+
+// fresh coroutine stack that returns into entry()
+uint32_t* co_init(uint32_t* top, void (*entry)(void)) {
+    uint32_t* sp = (uint32_t*)((uintptr_t)top & ~15u);
+    *--sp = 0;                      // fake return address of entry
+    *--sp = (uint32_t)entry;
+    for (int i = 0; i < 4; i++) *--sp = 0;
+    return sp;
+}
+
+extern int sim_main(void);
+uint8_t main_stack[1 << 20] __attribute__((aligned(16)));
+
+void sim_start_c(void) {
+    int rc = sim_main();
+    sim_flush();
+    sim_exit(rc);
+}
+
+__asm__(
+    ".globl _start\n"
+    "_start:\n"
+    "  movl $main_stack + (1 << 20), %esp\n"
+    "  andl $-16, %esp\n"
+    "  call sim_start_c\n");
@@ -0,0 +1,91 @@
+#!/bin/sh
+#
+# run.sh - build one host simulation harness against the kernel and run it
+#
+#     Tools/hostsim/run.sh Tools/hostsim/bench_sched.c -DLIVE=64
+#
+# The kernel sources are copied from Core/, the few Cortex-M intrinsics they
+# use (PSP, wfi, SCB/DWT registers, svc) are patched to hooks in port.c, and
+# everything is linked into a freestanding 32 bit x86 binary, so struct
+# layouts and pointer sizes match the target. Needs gcc with -m32 code
+# generation only, no 32 bit libc. Extra arguments go to the compiler.
+#
+set -e
+SIM=$(cd "$(dirname "$0")" && pwd)
+REPO=$(cd "$SIM/../.." && pwd)
+HARNESS=$1
+shift
+
+NAME=$(basename "$HARNESS" .c)
+for a in "$@"; do
+    NAME="${NAME}_$(printf '%s' "$a" | tr -c 'A-Za-z0-9' '_')"
+done
+B=$SIM/build/$NAME
+rm -rf "$B"
+mkdir -p "$B/inc" "$B/src"
+
+# headers with LF endings, the sim versions of k_crit.h and main.h win
+for f in "$REPO"/Core/Inc/*.h; do
+    tr -d '\r' < "$f" > "$B/inc/$(basename "$f")"
+done
+cp "$SIM/stub/k_crit.h" "$SIM/stub/main.h" "$B/inc/"
+
+# keep the syscall numbers, swap the svc stubs for a direct SVC_Handler_Main call
+python3 - "$B/inc/k_syscall.h" <<'PY'
+import sys
+p = sys.argv[1]
+s = open(p).read()
+s = s[:s.index('// r1-r3 and r12 come back')] + '''U32 sim_svc(U32 nr, U32 a0, U32 a1, U32 a2, U32 a3);
+static inline U32 k_syscall0(U32 nr) { SYSCALL_STAT_BEGIN(); U32 r = sim_svc(nr, 0, 0, 0, 0); SYSCALL_STAT_END(nr); return r; }
+static inline U32 k_syscall1(U32 nr, U32 a0) { SYSCALL_STAT_BEGIN(); U32 r = sim_svc(nr, a0, 0, 0, 0); SYSCALL_STAT_END(nr); return r; }
+static inline U32 k_syscall2(U32 nr, U32 a0, U32 a1) { SYSCALL_STAT_BEGIN(); U32 r = sim_svc(nr, a0, a1, 0, 0); SYSCALL_STAT_END(nr); return r; }
+static inline U32 k_syscall3(U32 nr, U32 a0, U32 a1, U32 a2) { SYSCALL_STAT_BEGIN(); U32 r = sim_svc(nr, a0, a1, a2, 0); SYSCALL_STAT_END(nr); return r; }
+static inline U32 k_syscall4(U32 nr, U32 a0, U32 a1, U32 a2, U32 a3) { SYSCALL_STAT_BEGIN(); U32 r = sim_svc(nr, a0, a1, a2, a3); SYSCALL_STAT_END(nr); return r; }
+#endif
+'''
+s = s.replace('(*(volatile U32 *)0xE0001004UL)', '(*sim_cyccnt())')
+open(p, 'w').write(s)
+PY
+
+# linker script sections become plain named sections (__start_/__stop_ symbols)
+sed -i 's/section("\.rtx_tasks")/section("rtx_tasks")/' "$B/inc/k_task.h"
+sed -i 's/section("\.[a-z.]*kshared")/section("kshared")/' "$B/inc/k_shared.h"
+
+SRCS="os_kernel.c stm32f4xx_it.c k_cbs.c k_mem.c k_pool.c k_slab.c k_timer.c k_tasklet.c k_workq.c"
+for f in $SRCS main.c; do
+    tr -d '\r' < "$REPO/Core/Src/$f" > "$B/src/$f"
+    sed -i 's/__asm("wfi")/sim_wfi()/; s/__asm volatile ("ISB")/(void)0/' "$B/src/$f"
+done
+
+K=$B/src/os_kernel.c
+sed -i 's/__asm volatile ("MRS %0, psp" : "=r" (result));/result = sim_psp;/' "$K"
+sed -i 's/__asm volatile ("MSR psp, %0" : : "r" (topOfProcStack) : "sp");/sim_psp = topOfProcStack;/' "$K"
+sed -i 's/__asm volatile ("dsb 0xF":::"memory");//; s/__asm volatile ("cpsid i" : : : "memory");//' "$K"
+sed -i 's/(\*(volatile \(uint[0-9]*_t\) \*)\(0xE000[0-9A-F]*UL\))/(*(volatile \1 *)sim_reg(\2))/' "$K"
+sed -i 's/#define DWT_CYCCNT .*/#define DWT_CYCCNT (*sim_cyccnt())/' "$K"
+sed -i 's/#define SCB_BASE (0xE000ED00UL)/#define SCB_BASE sim_reg(0xE000ED00UL)/' "$K"
+sed -i 's/#define SysTick_BASE (0xE000E010UL)/#define SysTick_BASE sim_reg(0xE000E010UL)/' "$K"
+sed -i 's/__rtx_tasks_start/__start_rtx_tasks/g; s/__rtx_tasks_end/__stop_rtx_tasks/g' "$K"
+sed -i 's/^extern const static_task_t \(__[a-z_]*\)\[\];/extern const static_task_t \1[] __attribute__((weak));/' "$K"
+
+# the heap is an array in the harness instead of the space after .bss
+M=$B/src/k_mem.c
+sed -i '1i extern unsigned char sim_arena[];' "$M"
+sed -i 's/heap_start = (U8\*)&_img_end + 0x200;/heap_start = sim_arena;/' "$M"
+sed -i 's/heap_end = (U8\*)&_estack - (U32)&_Min_Stack_Size;/heap_end = sim_arena + SIM_HEAP;/' "$M"
+
+CFLAGS="-m32 -O2 -g -std=gnu11 -ffreestanding -fno-pie -fno-stack-protector -fno-builtin -fno-strict-aliasing -w
+    -DUSE_HAL_DRIVER -DSTM32F401xE -include $SIM/stub/port.h -I$B/inc -I$B/src
+    -I$REPO/Drivers/STM32F4xx_HAL_Driver/Inc -I$REPO/Drivers/CMSIS/Device/ST/STM32F4xx/Include
+    -I$REPO/Drivers/CMSIS/Include"
+
+OBJS=""
+for f in $(for s in $SRCS; do echo "$B/src/$s"; done) "$SIM/port.c" "$HARNESS"; do
+    o=$B/$(basename "$f" .c).o
+    gcc $CFLAGS "$@" -c "$f" -o "$o"
+    OBJS="$OBJS $o"
+done
+gcc -m32 -O2 -ffreestanding -fno-pie -fno-stack-protector -c "$SIM/rt.c" -o "$B/rt.o"
+gcc -m32 -nostdlib -static -no-pie -o "$B/sim" $OBJS "$B/rt.o"
+
+"$B/sim"
@@ -0,0 +1,23 @@
+#ifndef INC_K_CRIT_H_
+#define INC_K_CRIT_H_
+#include "common.h"
+#define KERNEL_PRIO_BITS 4
+#define KERNEL_PRIO_LOWEST ((1 << KERNEL_PRIO_BITS) - 1)
+#ifndef KERNEL_IRQ_CEILING
+#define KERNEL_IRQ_CEILING 5
+#endif
+#define KERNEL_BASEPRI (KERNEL_IRQ_CEILING << (8 - KERNEL_PRIO_BITS))
+extern U32 sim_basepri;
+void sim_crit_released(void);
+static inline U32 k_crit_enter(void) {
+    U32 prev = sim_basepri;
+    sim_basepri = 1;
+    return prev;
+}
+static inline void k_crit_exit(U32 prev) {
+    sim_basepri = prev;
+    if (prev == 0) {
+        sim_crit_released();
+    }
+}
+#endif
@@ -0,0 +1,13 @@
+#ifndef __MAIN_H
+#define __MAIN_H
+#include "stm32f4xx_hal.h"
+#undef DWT
+#undef CoreDebug
+DWT_Type* sim_dwt(void);
+#define DWT sim_dwt()
+#define CoreDebug ((CoreDebug_Type*)sim_reg(CoreDebug_BASE))
+void Error_Handler(void);
+void SystemClock_Config(void);
+void MX_GPIO_Init(void);
+void MX_USART2_UART_Init(void);
+#endif
@@ -0,0 +1,16 @@
+// forced include for every kernel TU in the host sim
+#ifndef SIM_PORT_H
+#define SIM_PORT_H
+#include <stdint.h>
+
+// bytes handed to k_mem as the heap
+#ifndef SIM_HEAP
+#define SIM_HEAP (64 * 1024)
+#endif
+
+void sim_wfi(void);
+void* sim_reg(uint32_t addr);
+volatile uint32_t* sim_cyccnt(void);
+extern uint32_t sim_psp;
+int printf(const char* fmt, ...);
+#endif
@@ -0,0 +1,105 @@
+// a task over its CPU budget is held to budget/deadline in every window
+//   run.sh test_budget.c -DBUDGET_ENFORCE=1 [-DDEMOTE=1] [-DEND_MS=10000]
+// hog: deadline 10, 2.5 ms budget, caught at the next tick so it runs 3 ms a
+// window. It never blocks, only calls osYield.
+// throttle: the hog runs alone, so nothing else is ready while it sleeps
+// out a window; it must get 30 % and nothing more.
+// DEMOTE=1: a background task with deadline 100 shares the CPU. The hog gets
+// 30 % of the first half, then the background task sets the hog's deadline
+// to 20 while it is demoted, which must stick: 15 % of the second half.
+// Exits 1 on failure.
+#include "common.h"
+#include "k_task.h"
+
+#if !BUDGET_ENFORCE
+#error build with -DBUDGET_ENFORCE=1
+#endif
+
+#ifndef DEMOTE
+#define DEMOTE 0
+#endif
+
+#ifndef END_MS
+#define END_MS 10000
+#endif
+
+unsigned char sim_arena[SIM_HEAP] __attribute__((aligned(8)));
+extern uint64_t sim_end_us, sim_now_us, sim_task_us[];
+extern int sim_cycles_from_time;
+extern void sim_work(uint64_t us);
+extern int sim_printf(const char* f, ...);
+extern void sim_flush(void);
+extern void sim_exit(int code);
+
+static TCB hog_tcb, background_tcb;
+static uint64_t hog_us_half;
+static int deadline_set;
+
+static void hog(void* args) {
+    while (1) {
+        sim_work(500);
+        osYield();
+    }
+}
+
+static void background(void* args) {
+    while (1) {
+        sim_work(500);
+        // only runs while the hog is demoted
+        if (!deadline_set && sim_now_us >= END_MS * 500ULL) {
+            hog_us_half = sim_task_us[hog_tcb.tid];
+            osSetDeadline(20, hog_tcb.tid);
+            deadline_set = 1;
+        }
+    }
+}
+
+static int share_ok(const char* name, uint64_t us, uint64_t span, U32 expect) {
+    U32 pct = (U32)(us * 100 / span);
+    int ok = pct + 2 >= expect && pct <= expect + 2;
+    sim_printf("%-24s %3u %% of the CPU, expected %u %%%s\n", name, pct, expect, ok ? "" : "  <-- FAIL");
+    return ok;
+}
+
+void sim_report(void) {
+    int ok;
+#if DEMOTE
+    uint64_t half = sim_end_us / 2;
+    ok = share_ok("hog, deadline 10", hog_us_half, half, 30);
+    ok &= share_ok("hog, deadline 20", sim_task_us[hog_tcb.tid] - hog_us_half, sim_end_us - half, 15);
+#else
+    ok = share_ok("hog, throttled", sim_task_us[hog_tcb.tid], sim_end_us, 30);
+#endif
+    sim_printf("overruns %u, deadline now %u\n", g_task_budget_overruns[hog_tcb.tid],
+               g_task_deadline[hog_tcb.tid]);
+    sim_printf("%s\n", ok ? "PASS" : "FAIL");
+    if (!ok) {
+        sim_flush();
+        sim_exit(1);
+    }
+}
+
+int sim_main(void) {
+    sim_end_us = END_MS * 1000ULL;
+    sim_cycles_from_time = 1;
+    osKernelInit();
+
+    hog_tcb.ptask = hog;
+    hog_tcb.stack_size = STACK_SIZE;
+    if (osCreateDeadlineTask(10, &hog_tcb) != RTX_OK ||
+        osSetBudget(hog_tcb.tid, 2500, DEMOTE ? BUDGET_DEMOTE : BUDGET_THROTTLE) != RTX_OK) {
+        sim_printf("create failed\n");
+        return 1;
+    }
+#if DEMOTE
+    background_tcb.ptask = background;
+    background_tcb.stack_size = STACK_SIZE;
+    if (osCreateDeadlineTask(100, &background_tcb) != RTX_OK) {
+        sim_printf("create failed\n");
+        return 1;
+    }
+#endif
+
+    osKernelStart();
+    return 0;
+}
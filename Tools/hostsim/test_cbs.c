@@ -0,0 +1,75 @@
+// a server that never runs out of work keeps its Q/T share for the whole run
+//   run.sh test_cbs.c [-DEND_MS=20000]
+// server Q=3 T=10 next to a hard task C=5 T=10 and a busy background task
+// with deadline 100; exits 1 unless the three get 30/50/20 % of the CPU
+#include "common.h"
+#include "k_task.h"
+#include "k_cbs.h"
+
+#ifndef END_MS
+#define END_MS 10000
+#endif
+
+unsigned char sim_arena[SIM_HEAP] __attribute__((aligned(8)));
+extern uint64_t sim_end_us, sim_task_us[];
+extern void sim_work(uint64_t us);
+extern int sim_printf(const char* f, ...);
+extern void sim_flush(void);
+extern void sim_exit(int code);
+
+static k_cbs_t server;
+static TCB server_tcb, hard_tcb, background_tcb;
+
+static void busy(void* args) {
+    while (1) {
+        sim_work(1000);
+    }
+}
+
+static void hard(void* args) {
+    while (1) {
+        sim_work(5000);
+        osPeriodYield();
+    }
+}
+
+static int share_ok(const char* name, task_t tid, U32 expect) {
+    U32 pct = (U32)(sim_task_us[tid] * 100 / sim_end_us);
+    int ok = pct + 2 >= expect && pct <= expect + 2;
+    sim_printf("%-10s %3u %% of the CPU, expected %u %%%s\n", name, pct, expect, ok ? "" : "  <-- FAIL");
+    return ok;
+}
+
+void sim_report(void) {
+    int ok = share_ok("server", server_tcb.tid, 30);
+    ok &= share_ok("hard", hard_tcb.tid, 50);
+    ok &= share_ok("background", background_tcb.tid, 20);
+    sim_printf("server postponed %u times, relative deadline %u\n", server.postponed,
+               g_task_deadline[server_tcb.tid]);
+    sim_printf("%s\n", ok ? "PASS" : "FAIL");
+    if (!ok) {
+        sim_flush();
+        sim_exit(1);
+    }
+}
+
+int sim_main(void) {
+    sim_end_us = END_MS * 1000ULL;
+    osKernelInit();
+
+    server_tcb.ptask = busy;
+    server_tcb.stack_size = STACK_SIZE;
+    hard_tcb.ptask = hard;
+    hard_tcb.stack_size = STACK_SIZE;
+    background_tcb.ptask = busy;
+    background_tcb.stack_size = STACK_SIZE;
+    if (osCreateServerTask(&server, 3, 10, &server_tcb) != RTX_OK ||
+        osCreateDeadlineTask(10, &hard_tcb) != RTX_OK ||
+        osCreateDeadlineTask(100, &background_tcb) != RTX_OK) {
+        sim_printf("create failed\n");
+        return 1;
+    }
+
+    osKernelStart();
+    return 0;
+}
@@ -0,0 +1,93 @@
+// osSchedLock holds back the switches its owner's wakeups ask for, and only
+// while the owner runs
+//   run.sh test_sched_lock.c
+// A (deadline 20) locks and notifies B (deadline 2): B must not run before A
+// unlocks. A then sleeps with the lock held and C (deadline 50) notifies B:
+// B must preempt C at once. Exits 1 on failure.
+#include "common.h"
+#include "k_task.h"
+
+unsigned char sim_arena[SIM_HEAP] __attribute__((aligned(8)));
+extern void sim_work(uint64_t us);
+extern int sim_printf(const char* f, ...);
+extern void sim_flush(void);
+extern void sim_exit(int code);
+extern void sim_finish(void);
+
+static TCB a_tcb, b_tcb, c_tcb;
+static volatile int a_unlocked, b_runs, a_asleep;
+static int failed;
+
+static void check(int ok, const char* what) {
+    sim_printf("%-44s %s\n", what, ok ? "ok" : "FAIL");
+    failed |= !ok;
+}
+
+static void task_b(void* args) {
+    while (1) {
+        osNotifyWait(1);
+        b_runs++;
+    }
+}
+
+static void task_c(void* args) {
+    while (!a_asleep) {
+        sim_work(100);
+    }
+    int before = b_runs;
+    osNotify(b_tcb.tid, 1);
+    check(b_runs == before + 1, "owner asleep, wakeup preempts at once");
+    while (1) {
+        sim_work(1000);
+    }
+}
+
+static void task_a(void* args) {
+    // let B reach osNotifyWait
+    osSleep(2);
+
+    osSchedLock();
+    osSchedLock();
+    osNotify(b_tcb.tid, 1);
+    sim_work(2000);
+    check(b_runs == 0, "notify under the lock does not switch");
+    osYield();
+    check(b_runs == 0, "osYield under the lock does not switch");
+    osSchedUnlock();
+    check(b_runs == 0, "inner unlock does not switch");
+    osSchedUnlock();
+    check(b_runs == 1, "outer unlock runs the woken task");
+
+    osSchedLock();
+    a_asleep = 1;
+    osSleep(5);
+    a_asleep = 0;
+    osSchedUnlock();
+    check(osSchedUnlock() == RTX_ERR, "unbalanced unlock is refused");
+
+    sim_printf("%s\n", failed ? "FAIL" : "PASS");
+    if (failed) {
+        sim_flush();
+        sim_exit(1);
+    }
+    sim_finish();
+}
+
+int sim_main(void) {
+    osKernelInit();
+
+    a_tcb.ptask = task_a;
+    a_tcb.stack_size = STACK_SIZE;
+    b_tcb.ptask = task_b;
+    b_tcb.stack_size = STACK_SIZE;
+    c_tcb.ptask = task_c;
+    c_tcb.stack_size = STACK_SIZE;
+    if (osCreateDeadlineTask(20, &a_tcb) != RTX_OK || osCreateDeadlineTask(2, &b_tcb) != RTX_OK ||
+        osCreateDeadlineTask(50, &c_tcb) != RTX_OK) {
+        sim_printf("create failed\n");
+        return 1;
+    }
+
+    osKernelStart();
+    return 0;
+}
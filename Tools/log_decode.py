@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+"""
+log_decode.py
+
+Turns the raw LOG() stream written by k_log_flush() back into text using
+the format strings stored in the .log_fmt section of the firmware ELF.
+
+    python3 Tools/log_decode.py Debug/ece350_start.elf capture.bin
+    python3 Tools/log_decode.py Debug/ece350_start.elf /dev/ttyACM0 --baud 115200
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+LOG_MAGIC = 0xA5
+LOG_HDR_WORDS = 3
+LOG_ID_DROPPED = 0xFFFFFFFF
+
+
+def read_section(elf_path, name):
+    """returns (address, bytes) of a section in a 32 bit little endian ELF"""
+    with open(elf_path, 'rb') as f:
+        elf = f.read()
+
+    if elf[:4] != b'\x7fELF' or elf[4] != 1:
+        sys.exit('%s is not a 32 bit ELF' % elf_path)
+
+    shoff, = struct.unpack_from('<I', elf, 0x20)
+    shentsize, shnum, shstrndx = struct.unpack_from('<HHH', elf, 0x2E)
+
+    def header(i):
+        return struct.unpack_from('<IIIIII', elf, shoff + i * shentsize)
+
+    strtab = header(shstrndx)
+    for i in range(shnum):
+        sh_name, _, _, sh_addr, sh_offset, sh_size = header(i)
+        start = strtab[4] + sh_name
+        if elf[start:elf.index(b'\0', start)].decode() == name:
+            return sh_addr, elf[sh_offset:sh_offset + sh_size]
+
+    sys.exit('%s has no %s section, was it linked with LOG() calls?' % (elf_path, name))
+
+
+# printf conversion -> python conversion
+FMT_RE = re.compile(r'%([-+ #0]*)(\d*|\*)(?:\.(\d+))?(hh|h|ll|l|z|j|t)?([diouxXcspn%])')
+
+
+def to_signed(value):
+    return value - (1 << 32) if value & 0x80000000 else value
+
+
+def format_line(fmt, args):
+    it = iter(args)
+
+    def conv(m):
+        flags, width, prec, _, spec = m.groups()
+        if spec == '%':
+            return '%'
+        value = next(it, 0)
+        prec = '.' + prec if prec else ''
+        if spec in 'di':
+            return ('%' + flags + width + prec + 'd') % to_signed(value)
+        if spec == 'u':
+            return ('%' + flags + width + prec + 'd') % value
+        if spec == 'p':
+            return '0x%08x' % value
+        if spec == 's':
+            return '<str@0x%08x>' % value
+        if spec == 'n':
+            return ''
+        return ('%' + flags + width + prec + spec) % value
+
+    return FMT_RE.sub(conv, fmt)
+
+
+def records(stream):
+    """yields (tid, fmt_id, timestamp, args), resyncing on the magic byte"""
+    buf = b''
+    while True:
+        chunk = stream.read(256)
+        if not chunk:
+            return
+        buf += chunk
+
+        while len(buf) >= 4 * LOG_HDR_WORDS:
+            header, = struct.unpack_from('<I', buf, 0)
+            nargs = (header >> 16) & 0xFF
+            if (header >> 24) != LOG_MAGIC or nargs > 4:
+                buf = buf[1:]
+                continue
+
+            size = 4 * (LOG_HDR_WORDS + nargs)
+            if len(buf) < size:
+                break
+
+            words = struct.unpack_from('<%dI' % (LOG_HDR_WORDS + nargs), buf, 0)
+            buf = buf[size:]
+            yield header & 0xFFFF, words[1], words[2], words[3:]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('elf', help='firmware ELF the log came from')
+    parser.add_argument('input', help='raw capture file or serial port, - for stdin')
+    parser.add_argument('--baud', type=int, default=115200, help='baud rate when input is a serial port')
+    opts = parser.parse_args()
+
+    base, strings = read_section(opts.elf, '.log_fmt')
+
+    if opts.input == '-':
+        stream = sys.stdin.buffer
+    elif opts.input.startswith('/dev/') or opts.input.upper().startswith('COM'):
+        import serial
+        stream = serial.Serial(opts.input, opts.baud)
+    else:
+        stream = open(opts.input, 'rb')
+
+    for tid, fmt_id, timestamp, args in records(stream):
+        if fmt_id == LOG_ID_DROPPED:
+            line = '*** %d records dropped ***' % args[0]
+        else:
+            offset = fmt_id - base
+            if offset < 0 or offset >= len(strings):
+                line = '<unknown format id 0x%08x> %s' % (fmt_id, ' '.join('0x%x' % a for a in args))
+            else:
+                fmt = strings[offset:strings.index(b'\0', offset)].decode(errors='replace')
+                line = format_line(fmt, args)
+
+        sys.stdout.write('[%10d ms] [tid %2d] %s\n' % (timestamp, tid, line.rstrip('\r\n')))
+        sys.stdout.flush()
+
+
+if __name__ == '__main__':
+    main()
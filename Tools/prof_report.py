@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+"""
+prof_report.py
+
+Maps the histogram printed by k_prof_dump() to functions in the firmware
+ELF and prints the hottest functions and the per task split.
+
+    python3 Tools/prof_report.py Debug/ece350_start.elf uart_capture.txt
+"""
+
+import argparse
+import bisect
+import re
+import struct
+import sys
+
+STT_FUNC = 2
+
+
+def read_functions(elf_path):
+    """returns a sorted list of (address, size, name) for every FUNC symbol"""
+    with open(elf_path, 'rb') as f:
+        elf = f.read()
+
+    if elf[:4] != b'\x7fELF' or elf[4] != 1:
+        sys.exit('%s is not a 32 bit ELF' % elf_path)
+
+    shoff, = struct.unpack_from('<I', elf, 0x20)
+    shentsize, shnum = struct.unpack_from('<HH', elf, 0x2E)
+    sections = [struct.unpack_from('<IIIIIIIIII', elf, shoff + i * shentsize) for i in range(shnum)]
+
+    funcs = {}
+    for sh in sections:
+        if sh[1] != 2:  # SHT_SYMTAB
+            continue
+        strtab = sections[sh[6]]
+        for off in range(sh[4], sh[4] + sh[5], 16):
+            st_name, st_value, st_size, st_info = struct.unpack_from('<IIIB', elf, off)
+            if st_info & 0xF != STT_FUNC:
+                continue
+            start = strtab[4] + st_name
+            name = elf[start:elf.index(b'\0', start)].decode()
+            # clear the thumb bit
+            funcs[st_value & ~1] = (st_size, name)
+
+    if not funcs:
+        sys.exit('%s has no symbol table, build with debug info' % elf_path)
+
+    return sorted((addr, size, name) for addr, (size, name) in funcs.items())
+
+
+def lookup(funcs, starts, addr):
+    i = bisect.bisect_right(starts, addr) - 1
+    if i >= 0:
+        start, size, name = funcs[i]
+        if addr < start + max(size, 2):
+            return name
+    return '<0x%08x>' % addr
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('elf', help='firmware ELF the profile came from')
+    parser.add_argument('dump', help='UART capture containing a PROF BEGIN ... PROF END block')
+    parser.add_argument('--top', type=int, default=25, help='number of functions to list')
+    opts = parser.parse_args()
+
+    funcs = read_functions(opts.elf)
+    starts = [f[0] for f in funcs]
+
+    header = None
+    tasks = {}
+    per_func = {}
+
+    with open(opts.dump, errors='replace') as f:
+        for line in f:
+            line = line.strip()
+            m = re.match(r'PROF BEGIN base=(\S+) shift=(\d+) total=(\d+) isr=(\d+) other=(\d+)', line)
+            if m:
+                header = m.groups()
+                tasks, per_func = {}, {}
+                continue
+            parts = line.split()
+            if len(parts) == 4 and parts[:2] == ['PROF', 'T']:
+                tasks[int(parts[2])] = int(parts[3])
+            elif len(parts) == 4 and parts[:2] == ['PROF', 'B']:
+                name = lookup(funcs, starts, int(parts[2], 16))
+                per_func[name] = per_func.get(name, 0) + int(parts[3])
+
+    if header is None:
+        sys.exit('no PROF BEGIN block found in %s' % opts.dump)
+
+    total, isr, other = int(header[2]), int(header[3]), int(header[4])
+    in_text = sum(per_func.values())
+    print('samples: %d total, %d in tasks, %d in nested ISRs, %d outside .text' % (total, in_text, isr, other))
+    print('bucket width: %d bytes' % (1 << int(header[1])))
+    print()
+
+    print('%-8s %10s %7s' % ('task', 'samples', '%'))
+    for tid in sorted(tasks):
+        print('%-8d %10d %6.1f%%' % (tid, tasks[tid], 100.0 * tasks[tid] / max(total, 1)))
+    print()
+
+    print('%-40s %10s %7s' % ('function', 'samples', '%'))
+    for name, count in sorted(per_func.items(), key=lambda kv: -kv[1])[:opts.top]:
+        print('%-40s %10d %6.1f%%' % (name, count, 100.0 * count / max(total, 1)))
+
+
+if __name__ == '__main__':
+    main()
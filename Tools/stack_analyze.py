@@ -0,0 +1,206 @@
+#!/usr/bin/env python3
+"""
+stack_analyze.py
+
+Worst case stack depth per task, built from the .su files the build already
+writes (-fstack-usage) and a call graph taken from objdump of the ELF.
+Adds the exception frame a task has to hold when it gets switched out and
+prints a recommended stack_size for every task entry function.
+
+    python3 Tools/stack_analyze.py Debug/ece350_start.elf --task TaskA --task TaskB
+    python3 Tools/stack_analyze.py Debug/ece350_start.elf --task TaskA=1024 --check
+
+With --check the script exits with 1 if any configured size is too small,
+so it can run as a post-build step. It also prints the largest single frame
+the tasks can reach, MPU_GUARD_SIZE has to be at least that big for the MPU
+stack guard to catch every overflow.
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+
+# hardware frame with FPU state (lazy stacking reserves it) + R4-R11 pushed by PendSV
+EXCEPTION_FRAME = 0x68 + 8 * 4
+# painted words at the bottom of every stack checked on each switch (STACK_GUARD_WORDS)
+GUARD_BYTES = 4 * 4
+# minimum the kernel accepts (STACK_SIZE), recommendations never go below it
+MIN_STACK = 0x400
+
+FUNC_RE = re.compile(r'^([0-9a-f]+) <([^>]+)>:$')
+CALL_RE = re.compile(r'^\s*[0-9a-f]+:\s+(?:[0-9a-f]{4,8}\s)+\s*(bl|blx|b\.w|b)(?:\.n|\.w)?\s+([0-9a-f]+)\s+<([^>+]+)>')
+INDIRECT_RE = re.compile(r'^\s*[0-9a-f]+:\s+(?:[0-9a-f]{4,8}\s)+\s*blx\s+(r\d+|ip|lr)\b')
+
+
+def read_stack_usage(build_dir):
+    """function name -> (bytes, qualifier) from every .su file under build_dir"""
+    usage = {}
+    for root, _, files in os.walk(build_dir):
+        for name in files:
+            if not name.endswith('.su'):
+                continue
+            with open(os.path.join(root, name)) as f:
+                for line in f:
+                    parts = line.rstrip('\n').split('\t')
+                    if len(parts) != 3:
+                        continue
+                    func = parts[0].rsplit(':', 1)[-1]
+                    size = int(parts[1])
+                    # static functions with the same name in different files, keep the worst
+                    if func not in usage or usage[func][0] < size:
+                        usage[func] = (size, parts[2])
+    return usage
+
+
+def read_call_graph(elf, objdump):
+    """function name -> (set of callees, has indirect calls)"""
+    try:
+        out = subprocess.run([objdump, '-d', elf],
+                             check=True, capture_output=True, text=True).stdout
+    except (OSError, subprocess.CalledProcessError) as e:
+        sys.exit('could not run %s: %s' % (objdump, e))
+
+    graph = {}
+    current = None
+    for line in out.splitlines():
+        m = FUNC_RE.match(line)
+        if m:
+            current = m.group(2)
+            graph.setdefault(current, [set(), False])
+            continue
+        if current is None:
+            continue
+        m = CALL_RE.match(line)
+        if m:
+            target = m.group(3)
+            # plain branches inside the function are just jumps
+            if target != current:
+                graph[current][0].add(target)
+            continue
+        if INDIRECT_RE.match(line):
+            graph[current][1] = True
+
+    return graph
+
+
+class Analyzer:
+    def __init__(self, usage, graph):
+        self.usage = usage
+        self.graph = graph
+        self.memo = {}
+        self.unknown = set()
+        self.recursive = set()
+        self.indirect = set()
+
+    def depth(self, func, stack=()):
+        """returns (worst case bytes, call path)"""
+        if func in self.memo:
+            return self.memo[func]
+        if func in stack:
+            self.recursive.add(func)
+            return 0, []
+
+        if func in self.usage:
+            own = self.usage[func][0]
+            if self.usage[func][1] != 'static':
+                self.unknown.add(func + ' (' + self.usage[func][1] + ')')
+        else:
+            own = 0
+            self.unknown.add(func)
+
+        callees, indirect = self.graph.get(func, (set(), False))
+        if indirect:
+            self.indirect.add(func)
+
+        worst, worst_path = 0, []
+        for callee in sorted(callees):
+            d, path = self.depth(callee, stack + (func,))
+            if d > worst:
+                worst, worst_path = d, path
+
+        result = (own + worst, [(func, own)] + worst_path)
+        self.memo[func] = result
+        return result
+
+    def largest_frame(self, func, seen=None):
+        """returns (bytes, function) of the biggest single frame reachable from func"""
+        if seen is None:
+            seen = set()
+        if func in seen:
+            return 0, func
+        seen.add(func)
+
+        best = (self.usage.get(func, (0, ''))[0], func)
+        for callee in sorted(self.graph.get(func, (set(), False))[0]):
+            best = max(best, self.largest_frame(callee, seen))
+        return best
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('elf', help='firmware ELF')
+    parser.add_argument('--task', action='append', default=[], metavar='FUNC[=BYTES]',
+                        help='task entry function, optionally with its configured stack_size')
+    parser.add_argument('--build-dir', help='directory holding the .su files (default: the ELF directory)')
+    parser.add_argument('--objdump', default='arm-none-eabi-objdump')
+    parser.add_argument('--margin', type=int, default=10, help='safety margin in percent (default 10)')
+    parser.add_argument('--check', action='store_true', help='exit 1 if a configured stack_size is too small')
+    parser.add_argument('--verbose', action='store_true', help='print the worst case call path')
+    opts = parser.parse_args()
+
+    if not opts.task:
+        parser.error('give at least one --task')
+
+    usage = read_stack_usage(opts.build_dir or os.path.dirname(os.path.abspath(opts.elf)))
+    if not usage:
+        sys.exit('no .su files found, build with -fstack-usage')
+    graph = read_call_graph(opts.elf, opts.objdump)
+    analyzer = Analyzer(usage, graph)
+
+    failed = False
+    largest = (0, '')
+    print('%-24s %8s %8s %8s %12s %12s' % ('task', 'calls', 'frame', 'needed', 'recommended', 'configured'))
+    for spec in opts.task:
+        name, _, configured = spec.partition('=')
+        calls, path = analyzer.depth(name)
+        largest = max(largest, analyzer.largest_frame(name))
+        need = calls + EXCEPTION_FRAME + GUARD_BYTES
+        need = need + need * opts.margin // 100
+        recommended = max(MIN_STACK, (need + 7) & ~7)
+
+        status = ''
+        if configured:
+            if int(configured, 0) < need:
+                status = '  TOO SMALL'
+                failed = True
+            configured = str(int(configured, 0))
+        print('%-24s %8d %8d %8d %12d %12s%s' % (name, calls, EXCEPTION_FRAME + GUARD_BYTES, need, recommended,
+                                                 configured or '-', status))
+
+        if opts.verbose:
+            for func, own in path:
+                print('    %6d  %s' % (own, func))
+
+    # a frame bigger than the MPU guard can step over it without touching it
+    guard = 32
+    while guard < largest[0]:
+        guard *= 2
+    print('\nlargest frame %d bytes in %s, MPU_GUARD_SIZE >= %d' % (largest[0], largest[1], guard))
+
+    if analyzer.unknown:
+        print('\nno static size for (counted as 0 or as their .su lower bound):')
+        for func in sorted(analyzer.unknown):
+            print('    ' + func)
+    if analyzer.indirect:
+        print('\nindirect calls not followed in: ' + ', '.join(sorted(analyzer.indirect)))
+    if analyzer.recursive:
+        print('\nrecursion not bounded in: ' + ', '.join(sorted(analyzer.recursive)))
+
+    if opts.check and failed:
+        sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,148 @@
+#!/usr/bin/env python3
+"""
+tt_schedule.py
+
+Builds the time triggered dispatch table for TT_ENABLED builds. Every task
+is given as name:period:wcet in ms (name is the OS_TASK_DEFINE name), the
+jobs over one hyperperiod are laid out with non-preemptive EDF and the
+start tick of every job is written to a C file as g_tt_table[].
+
+    python3 Tools/tt_schedule.py --task task_a:4:1 --task task_c:12:2 -o Core/Src/tt_table.c
+
+The kernel releases the job of table entry i on tick i (mod the
+hyperperiod), so each job starts at the same offset every hyperperiod.
+wcet must be an upper bound in whole ticks including kernel overhead; a job
+that runs past the start of the next one is counted in g_tt_overruns.
+Exits with 1 if the task set does not fit.
+"""
+
+import argparse
+import math
+import sys
+
+
+def parse_task(text):
+    parts = text.split(':')
+    if len(parts) != 3:
+        raise argparse.ArgumentTypeError('expected name:period:wcet, got %r' % text)
+    name, period, wcet = parts[0], int(parts[1]), int(parts[2])
+    if period <= 0 or wcet <= 0 or wcet > period:
+        raise argparse.ArgumentTypeError('%s: need 0 < wcet <= period' % name)
+    return name, period, wcet
+
+
+def lcm(values):
+    result = 1
+    for v in values:
+        result = result * v // math.gcd(result, v)
+    return result
+
+
+def build_schedule(tasks, hyper):
+    """non-preemptive EDF over one hyperperiod, returns [(start, name, release, deadline)]"""
+    jobs = []
+    for name, period, wcet in tasks:
+        for release in range(0, hyper, period):
+            jobs.append((release, release + period, wcet, name))
+    jobs.sort()
+
+    placed = []
+    pending = []
+    t = 0
+    i = 0
+    while i < len(jobs) or pending:
+        # release everything due by now
+        while i < len(jobs) and jobs[i][0] <= t:
+            pending.append(jobs[i])
+            i += 1
+        if not pending:
+            t = jobs[i][0]
+            continue
+
+        pending.sort(key=lambda j: (j[1], j[0]))
+        release, deadline, wcet, name = pending.pop(0)
+        if t + wcet > deadline:
+            raise ValueError('%s released at %d misses its deadline %d (would finish at %d)'
+                             % (name, release, deadline, t + wcet))
+        placed.append((t, name, release, deadline))
+        t += wcet
+
+    return placed
+
+
+def write_table(path, tasks, hyper, placed):
+    slots = [None] * hyper
+    for start, name, _, _ in placed:
+        slots[start] = name
+
+    util = sum(w / p for _, p, w in tasks)
+    out = []
+    out.append('// generated by Tools/tt_schedule.py, do not edit')
+    for name, period, wcet in tasks:
+        out.append('// %s: period %d ms, wcet %d ms' % (name, period, wcet))
+    out.append('// hyperperiod %d ms, utilisation %.3f' % (hyper, util))
+    out.append('')
+    out.append('#include "k_task.h"')
+    out.append('#include "common.h"')
+    out.append('')
+    out.append('#ifndef NULL')
+    out.append('#define NULL ((void*)0)')
+    out.append('#endif')
+    out.append('')
+    for name, _, _ in tasks:
+        out.append('extern k_tcb_t %s_tcb;' % name)
+    out.append('')
+    out.append('// job released on each tick of the hyperperiod, NULL leaves the tick to EDF')
+    out.append('k_tcb_t* const g_tt_table[%d] = {' % hyper)
+    for tick, name in enumerate(slots):
+        entry = '&%s_tcb' % name if name else 'NULL'
+        out.append('    %s,%s// %d' % (entry, ' ' * max(1, 20 - len(entry)), tick))
+    out.append('};')
+    out.append('')
+    out.append('const U32 g_tt_table_len = %d;' % hyper)
+    out.append('')
+
+    with open(path, 'w') as f:
+        f.write('\n'.join(out))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='time triggered schedule table generator')
+    parser.add_argument('--task', action='append', type=parse_task, required=True,
+                        help='name:period:wcet in ms, name as given to OS_TASK_DEFINE')
+    parser.add_argument('-o', '--output', default='tt_table.c', help='C file to write')
+    parser.add_argument('--max-hyperperiod', type=int, default=10000,
+                        help='refuse tables longer than this many ticks')
+    args = parser.parse_args()
+
+    names = [t[0] for t in args.task]
+    if len(set(names)) != len(names):
+        sys.exit('duplicate task name')
+
+    hyper = lcm(p for _, p, _ in args.task)
+    if hyper > args.max_hyperperiod:
+        sys.exit('hyperperiod %d ms is longer than --max-hyperperiod %d, pick harmonic periods'
+                 % (hyper, args.max_hyperperiod))
+
+    util = sum(w / p for _, p, w in args.task)
+    if util > 1.0:
+        sys.exit('utilisation %.3f > 1, task set cannot fit' % util)
+
+    try:
+        placed = build_schedule(args.task, hyper)
+    except ValueError as e:
+        sys.exit('no schedule: %s' % e)
+
+    write_table(args.output, args.task, hyper, placed)
+
+    # per task worst response time, start jitter is zero by construction
+    print('hyperperiod %d ms, utilisation %.3f, %d jobs' % (hyper, util, len(placed)))
+    print('%-20s %8s %8s %10s' % ('task', 'period', 'wcet', 'max resp'))
+    for name, period, wcet in args.task:
+        resp = max(s + wcet - r for s, n, r, _ in placed if n == name)
+        print('%-20s %8d %8d %10d' % (name, period, wcet, resp))
+    print('wrote %s' % args.output)
+
+
+if __name__ == '__main__':
+    main()